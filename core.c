@@ -3,11 +3,28 @@
 #include <linux/err.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
 #include <linux/uaccess.h>
 #include <linux/fs.h>
+#include <linux/uio.h>
 #include <linux/cdev.h>
+#include <linux/moduleparam.h>
+#include <linux/math64.h>
+#include <linux/bitmap.h>
+#include <linux/log2.h>
+#include <linux/hrtimer.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/workqueue.h>
+#include <asm/barrier.h>
 
 #include "epd.h"
+#include "epd_ioctl.h"
+
+#define CREATE_TRACE_POINTS
+#include "epd_trace.h"
 
 #ifdef DEBUG
 #define DBG(...) printk("epd: "__VA_ARGS__)
@@ -20,21 +37,83 @@
 #define DRIVER_NAME "epd-ctl"
 #define DRIVER_DESC "Epaper display controller driver"
 
+#define EPD_HIST_NR 25
+
+/**
+ * struct epd_stats - Screen statistics, reset by the stats/reset attribute
+ * @updates: executed updates
+ * @skipped: updates skipped, frame being already displayed
+ * @coalesced: writes displayed by the update of a later write
+ * @lock_wait_ns: total time spent waiting for screen lock
+ * @lock_wait_max_ns: longest screen lock wait
+ * @update_hist: update duration histogram, bucket i > 0 counting durations
+ * from 2^(i - 1) to 2^i us (bucket 0 below 1 us, last one unbounded)
+ * @lock_wait_hist: screen lock wait histogram, same buckets
+ */
+struct epd_stats {
+	u64 updates;
+	u64 skipped;
+	u64 coalesced;
+	u64 lock_wait_ns;
+	u64 lock_wait_max_ns;
+	u64 update_hist[EPD_HIST_NR];
+	u64 lock_wait_hist[EPD_HIST_NR];
+};
+
+/*
+ * fold points to the displayed frame. It is either fbuf or, after a slot has
+ * been displayed, this slot frame. Lines of fnew that are not set in dirty
+ * bitmap are identical to fold ones. Submission ring entries are consumed by
+ * ring_work, ring_wait kicking it back when the next entry display time is
+ * reached. writes counts framebuffer writes and rectangle operations since last
+ * update.
+ */
 struct epd {
 	struct device *dev;
 	struct epd_driver *drv;
 	struct epd_frame *fold;
 	struct epd_frame *fnew;
+	struct epd_frame *fbuf;
+	struct epd_frame **slots;
+	unsigned int nr_slots;
+	unsigned long *dirty;
+	unsigned int rotate;
+	s64 deadline_latency;
+	bool mirror;
+	bool invert;
+	bool native;
 	struct mutex lock;
 	unsigned int id;
+	unsigned int writes;
+	struct epd_stats stats;
+	struct epd_ring_hdr *ring;
+	size_t ring_sz;
+	size_t ring_frame_sz;
+	u32 ring_entries;
+	u32 ring_sq_head;
+	u32 ring_cq_tail;
+	struct work_struct ring_work;
+	struct delayed_work ring_wait;
 };
 #define EPD_DEVT(e) MKDEV(epd_major, e->id + 1)
 
 #define EPD_CTL_CLEAR 'C'
 #define EPD_CTL_BLACK 'B'
 #define EPD_CTL_WRITE 'W'
+#define EPD_CTL_FORCE 'F'
+#define EPD_CTL_SLOT 'S'
+
+/* Draw frame even if it is identical to the displayed one */
+#define EPD_DRAW_FORCE (1 << 0)
 
 #define EPD_MAX_DEVICES 15
+#define EPD_MAX_SLOTS 64
+#define EPD_MAX_ENCODED_SZ (1 << 20)
+#define EPD_DEADLINE_MAX_MS 60000
+
+static unsigned int nr_slots = 4;
+module_param(nr_slots, uint, 0444);
+MODULE_PARM_DESC(nr_slots, "Number of preloaded frame slots per screen");
 
 static int epd_major;
 static struct cdev epd_cdev;
@@ -85,50 +164,170 @@ static void epd_frame_cleanup(struct epd_frame *frame)
 		kfree(frame);
 }
 
+static void epd_frame_set_geometry(struct epd_frame *frame, size_t line,
+		size_t col, unsigned int xform)
+{
+	frame->nrline = line;
+	frame->nrdot = col;
+	frame->bytes_per_line = DIV_ROUND_UP(col, 8);
+	frame->xform = xform;
+}
+
+/* Frames are large enough to hold both panel and transposed geometries */
 static struct epd_frame *epd_frame_create(size_t line, size_t col)
 {
 	struct epd_frame *f;
-	unsigned int bytes_per_line = DIV_ROUND_UP(col, 8);
+	size_t sz;
 
-	f = kmalloc(sizeof(*f) + line * bytes_per_line, GFP_KERNEL);
+	sz = max_t(size_t, line * DIV_ROUND_UP(col, 8),
+			col * DIV_ROUND_UP(line, 8));
+	f = kmalloc(sizeof(*f) + sz, GFP_KERNEL);
 	if(f == NULL)
 		return NULL;
 
-	f->nrline = line;
-	f->nrdot = col;
-	f->bytes_per_line = bytes_per_line;
+	epd_frame_set_geometry(f, line, col, 0);
 
 	return f;
 }
 
-static void epd_frame_black(struct epd_frame *frame)
+static void epd_frame_copy(struct epd_frame *dst, struct epd_frame const *src)
+{
+	epd_frame_set_geometry(dst, src->nrline, src->nrdot, src->xform);
+	memcpy(dst->data, src->data, src->nrline * src->bytes_per_line);
+}
+
+/* Transpose a 8x8 pixels block, byte i bit j going to byte j bit i */
+static u64 epd_transpose8(u64 x)
 {
-	size_t i, j;
+	u64 t;
 
-	for(i = 0; i < frame->nrline; ++i)
-		for(j = 0; j < frame->bytes_per_line; ++j)
-			frame->data[i * frame->bytes_per_line + j] = 0xff;
+	t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+	x = x ^ t ^ (t << 28);
+
+	return x;
+}
+
+/*
+ * Frame is transposed by 8x8 pixels blocks, so that each source and destination
+ * byte is only accessed once and lines are walked 8 at a time.
+ */
+void epd_frame_transpose(struct epd_frame const *src, struct epd_frame *dst)
+{
+	size_t sbpl = src->bytes_per_line, dbpl, bx, by, i;
+	u64 blk;
+
+	epd_frame_set_geometry(dst, src->nrdot, src->nrline,
+			src->xform & ~EPD_XFORM_TRANSPOSE);
+	dbpl = dst->bytes_per_line;
+
+	for(by = 0; by < dbpl; ++by) {
+		for(bx = 0; bx < sbpl; ++bx) {
+			blk = 0;
+			for(i = 0; i < 8 && by * 8 + i < src->nrline; ++i)
+				blk |= (u64)src->data[(by * 8 + i) * sbpl + bx] <<
+					(8 * i);
+			blk = epd_transpose8(blk);
+			for(i = 0; i < 8 && bx * 8 + i < dst->nrline; ++i)
+				dst->data[(bx * 8 + i) * dbpl + by] = blk >> (8 * i);
+		}
+	}
+}
+EXPORT_SYMBOL(epd_frame_transpose);
+
+static void epd_frame_fill(struct epd_frame *frame, u8 pattern)
+{
+	memset(frame->data, pattern, frame->nrline * frame->bytes_per_line);
+}
+
+static void epd_frame_black(struct epd_frame *frame)
+{
+	epd_frame_fill(frame, 0xff);
 }
 
 static void epd_frame_white(struct epd_frame *frame)
 {
-	size_t i, j;
+	epd_frame_fill(frame, 0x00);
+}
 
-	for(i = 0; i < frame->nrline; ++i)
-		for(j = 0; j < frame->bytes_per_line; ++j)
-			frame->data[i * frame->bytes_per_line + j] = 0x00;
+static void epd_mark_dirty(struct epd *epd, unsigned int line, unsigned int nr)
+{
+	bitmap_set(epd->dirty, line, nr);
+}
+
+static void epd_mark_clean(struct epd *epd)
+{
+	bitmap_zero(epd->dirty, epd->fnew->nrline);
 }
 
+static void epd_hist_add(u64 *hist, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int i = 0;
+
+	if(us != 0)
+		i = min_t(unsigned int, ilog2(us) + 1, EPD_HIST_NR - 1);
+	++hist[i];
+}
+
+/* Take screen lock, accounting the time spent waiting for it */
+static void epd_lock(struct epd *epd)
+{
+	ktime_t start = ktime_get();
+	u64 wait;
+
+	mutex_lock(&epd->lock);
+	wait = ktime_to_ns(ktime_sub(ktime_get(), start));
+	epd->stats.lock_wait_ns += wait;
+	if(wait > epd->stats.lock_wait_max_ns)
+		epd->stats.lock_wait_max_ns = wait;
+	epd_hist_add(epd->stats.lock_wait_hist, wait);
+}
+
+/* Account an update started at start, screen lock being held */
+static void epd_stats_update(struct epd *epd, ktime_t start)
+{
+	++epd->stats.updates;
+	if(epd->writes > 1)
+		epd->stats.coalesced += epd->writes - 1;
+	epd->writes = 0;
+	epd_hist_add(epd->stats.update_hist,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
+}
+
+static void epd_stats_skip(struct epd *epd)
+{
+	++epd->stats.skipped;
+	epd->writes = 0;
+}
+
+static void epd_ring_work(struct work_struct *work);
+static void epd_ring_wait(struct work_struct *work);
+
 static void epd_destroy(struct epd *epd)
 {
+	unsigned int i;
+
+	cancel_delayed_work_sync(&epd->ring_wait);
+	cancel_work_sync(&epd->ring_work);
+	vfree(epd->ring);
 	if(epd->dev) {
 		epd_device_remove(epd);
 		device_destroy(epddev_class, EPD_DEVT(epd));
 	}
-	if(epd->fold)
-		epd_frame_cleanup(epd->fold);
+	if(epd->fbuf)
+		epd_frame_cleanup(epd->fbuf);
 	if(epd->fnew)
 		epd_frame_cleanup(epd->fnew);
+	if(epd->slots) {
+		for(i = 0; i < epd->nr_slots; ++i)
+			epd_frame_cleanup(epd->slots[i]);
+		kfree(epd->slots);
+	}
+	kfree(epd->dirty);
 	kfree(epd);
 }
 
@@ -138,6 +337,12 @@ struct epd_frame *epd_get_cur_fb(struct epd *epd)
 }
 EXPORT_SYMBOL(epd_get_cur_fb);
 
+unsigned int epd_get_id(struct epd *epd)
+{
+	return epd->id;
+}
+EXPORT_SYMBOL(epd_get_id);
+
 struct epd_frame *epd_get_alt_fb(struct epd *epd)
 {
 	return epd->fnew;
@@ -151,11 +356,313 @@ void epd_put(struct epd *epd)
 }
 EXPORT_SYMBOL(epd_put);
 
+/* Transforms from user frames to panel for current orientation settings */
+static unsigned int epd_xform(struct epd *epd)
+{
+	static unsigned int const rot[] = {
+		0,
+		EPD_XFORM_TRANSPOSE | EPD_XFORM_VFLIP,
+		EPD_XFORM_VFLIP | EPD_XFORM_HFLIP,
+		EPD_XFORM_TRANSPOSE | EPD_XFORM_HFLIP,
+	};
+	unsigned int xform = rot[epd->rotate / 90];
+
+	/* Native frames are already in panel layout */
+	if(epd->native)
+		return EPD_XFORM_NATIVE;
+
+	/*
+	 * Mirroring a frame flips the panel lines once transposed, and flips
+	 * dots otherwise.
+	 */
+	if(epd->mirror)
+		xform ^= (xform & EPD_XFORM_TRANSPOSE) ? EPD_XFORM_VFLIP :
+			EPD_XFORM_HFLIP;
+	if(epd->invert)
+		xform |= EPD_XFORM_INVERT;
+
+	return xform;
+}
+
+/*
+ * Apply orientation settings to new frame and slots. Displayed frame keeps the
+ * transforms it has been drawn with. Frames are cleared if their geometry
+ * changes.
+ */
+static int epd_apply_xform(struct epd *epd)
+{
+	struct epd_frame_size const *framesz = epd->drv->framesz;
+	struct epd_frame *f;
+	unsigned int xform = epd_xform(epd), i;
+	size_t line = framesz->line, col = framesz->col;
+
+	if(xform & ~epd->drv->xforms)
+		return -EOPNOTSUPP;
+
+	if(xform & EPD_XFORM_TRANSPOSE)
+		swap(line, col);
+
+	/* Displayed slot is about to change */
+	if(epd->fold != epd->fbuf) {
+		epd_frame_copy(epd->fbuf, epd->fold);
+		epd->fold = epd->fbuf;
+	}
+
+	for(i = 0; i <= epd->nr_slots; ++i) {
+		f = (i == 0) ? epd->fnew : epd->slots[i - 1];
+		if(f->nrline != line) {
+			epd_frame_set_geometry(f, line, col, xform);
+			epd_frame_white(f);
+		}
+		f->xform = xform;
+	}
+	epd_mark_dirty(epd, 0, epd->fnew->nrline);
+
+	return 0;
+}
+
+static ssize_t rotate_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", READ_ONCE(epd->rotate));
+}
+
+static ssize_t rotate_store(struct device *dev, struct device_attribute *attr,
+		char const *buf, size_t count)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+	unsigned int rotate, old;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &rotate);
+	if(ret < 0)
+		return ret;
+
+	if(rotate % 90 != 0 || rotate >= 360)
+		return -EINVAL;
+
+	epd_lock(epd);
+	old = epd->rotate;
+	epd->rotate = rotate;
+	ret = epd_apply_xform(epd);
+	if(ret < 0)
+		epd->rotate = old;
+	mutex_unlock(&epd->lock);
+
+	if(ret < 0)
+		return ret;
+	return count;
+}
+static DEVICE_ATTR_RW(rotate);
+
+static ssize_t epd_bool_store(struct epd *epd, bool *val, char const *buf,
+		size_t count)
+{
+	bool b, old;
+	int ret;
+
+	ret = kstrtobool(buf, &b);
+	if(ret < 0)
+		return ret;
+
+	epd_lock(epd);
+	old = *val;
+	*val = b;
+	ret = epd_apply_xform(epd);
+	if(ret < 0)
+		*val = old;
+	mutex_unlock(&epd->lock);
+
+	if(ret < 0)
+		return ret;
+	return count;
+}
+
+static ssize_t mirror_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", READ_ONCE(epd->mirror));
+}
+
+static ssize_t mirror_store(struct device *dev, struct device_attribute *attr,
+		char const *buf, size_t count)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return epd_bool_store(epd, &epd->mirror, buf, count);
+}
+static DEVICE_ATTR_RW(mirror);
+
+static ssize_t invert_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", READ_ONCE(epd->invert));
+}
+
+static ssize_t invert_store(struct device *dev, struct device_attribute *attr,
+		char const *buf, size_t count)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return epd_bool_store(epd, &epd->invert, buf, count);
+}
+static DEVICE_ATTR_RW(invert);
+
+static ssize_t native_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", READ_ONCE(epd->native));
+}
+
+static ssize_t native_store(struct device *dev, struct device_attribute *attr,
+		char const *buf, size_t count)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return epd_bool_store(epd, &epd->native, buf, count);
+}
+static DEVICE_ATTR_RW(native);
+
+static ssize_t deadline_latency_ns_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lld\n",
+			(long long)READ_ONCE(epd->deadline_latency));
+}
+static DEVICE_ATTR_RO(deadline_latency_ns);
+
+static ssize_t predict_ns_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+	struct epd_driver *drv = epd->drv;
+	u64 duration, shown;
+	int ret;
+
+	if(drv->ops.predict == NULL)
+		return -EOPNOTSUPP;
+
+	ret = drv->ops.predict(drv, -1, &duration, &shown);
+	if(ret < 0)
+		return ret;
+
+	return sprintf(buf, "%llu %llu\n", (unsigned long long)duration,
+			(unsigned long long)shown);
+}
+static DEVICE_ATTR_RO(predict_ns);
+
+static struct attribute *epd_attrs[] = {
+	&dev_attr_rotate.attr,
+	&dev_attr_mirror.attr,
+	&dev_attr_invert.attr,
+	&dev_attr_native.attr,
+	&dev_attr_deadline_latency_ns.attr,
+	&dev_attr_predict_ns.attr,
+	NULL,
+};
+
+static struct attribute_group const epd_group = {
+	.attrs = epd_attrs,
+};
+
+#define EPD_STATS_ATTR(_name)						\
+static ssize_t _name##_show(struct device *dev,				\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	struct epd *epd = dev_get_drvdata(dev);				\
+	u64 val = READ_ONCE(epd->stats._name);				\
+									\
+	return sprintf(buf, "%llu\n", (unsigned long long)val);		\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+EPD_STATS_ATTR(updates);
+EPD_STATS_ATTR(skipped);
+EPD_STATS_ATTR(coalesced);
+EPD_STATS_ATTR(lock_wait_ns);
+EPD_STATS_ATTR(lock_wait_max_ns);
+
+static ssize_t epd_hist_show(u64 const *hist, char *buf)
+{
+	ssize_t len = 0;
+	unsigned int i;
+
+	for(i = 0; i < EPD_HIST_NR; ++i)
+		len += sprintf(buf + len, "%llu%c",
+				(unsigned long long)READ_ONCE(hist[i]),
+				(i + 1 < EPD_HIST_NR) ? ' ' : '\n');
+	return len;
+}
+
+static ssize_t update_hist_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return epd_hist_show(epd->stats.update_hist, buf);
+}
+static DEVICE_ATTR_RO(update_hist);
+
+static ssize_t lock_wait_hist_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	return epd_hist_show(epd->stats.lock_wait_hist, buf);
+}
+static DEVICE_ATTR_RO(lock_wait_hist);
+
+static ssize_t reset_store(struct device *dev, struct device_attribute *attr,
+		char const *buf, size_t count)
+{
+	struct epd *epd = dev_get_drvdata(dev);
+
+	epd_lock(epd);
+	memset(&epd->stats, 0, sizeof(epd->stats));
+	mutex_unlock(&epd->lock);
+	return count;
+}
+static DEVICE_ATTR_WO(reset);
+
+static struct attribute *epd_stats_attrs[] = {
+	&dev_attr_updates.attr,
+	&dev_attr_skipped.attr,
+	&dev_attr_coalesced.attr,
+	&dev_attr_lock_wait_ns.attr,
+	&dev_attr_lock_wait_max_ns.attr,
+	&dev_attr_update_hist.attr,
+	&dev_attr_lock_wait_hist.attr,
+	&dev_attr_reset.attr,
+	NULL,
+};
+
+static struct attribute_group const epd_stats_group = {
+	.name = "stats",
+	.attrs = epd_stats_attrs,
+};
+
+static struct attribute_group const *epd_groups[] = {
+	&epd_group,
+	&epd_stats_group,
+	NULL,
+};
+
 struct epd *epd_create(struct device *dev, struct epd_driver *drv)
 {
 	struct epd *epd;
 	struct device *edev;
 	struct epd_frame_size const *framesz;
+	unsigned int i;
 	int err;
 
 	/* TODO: use devmanagement devm_kzalloc() */
@@ -165,13 +672,17 @@ struct epd *epd_create(struct device *dev, struct epd_driver *drv)
 		goto fail;
 	}
 
+	INIT_WORK(&epd->ring_work, epd_ring_work);
+	INIT_DELAYED_WORK(&epd->ring_wait, epd_ring_wait);
+
 	framesz = drv->framesz;
 
-	epd->fold = epd_frame_create(framesz->line, framesz->col);
-	if(epd->fold == NULL) {
+	epd->fbuf = epd_frame_create(framesz->line, framesz->col);
+	if(epd->fbuf == NULL) {
 		err = -ENOMEM;
 		goto fail;
 	}
+	epd->fold = epd->fbuf;
 
 	epd->fnew = epd_frame_create(framesz->line, framesz->col);
 	if(epd->fnew == NULL) {
@@ -182,6 +693,33 @@ struct epd *epd_create(struct device *dev, struct epd_driver *drv)
 	epd_frame_black(epd->fold);
 	epd_frame_white(epd->fnew);
 
+	epd->nr_slots = min_t(unsigned int, nr_slots, EPD_MAX_SLOTS);
+	if(epd->nr_slots) {
+		epd->slots = kcalloc(epd->nr_slots, sizeof(*epd->slots),
+				GFP_KERNEL);
+		if(epd->slots == NULL) {
+			err = -ENOMEM;
+			goto fail;
+		}
+	}
+
+	for(i = 0; i < epd->nr_slots; ++i) {
+		epd->slots[i] = epd_frame_create(framesz->line, framesz->col);
+		if(epd->slots[i] == NULL) {
+			err = -ENOMEM;
+			goto fail;
+		}
+		epd_frame_white(epd->slots[i]);
+	}
+
+	epd->dirty = kcalloc(BITS_TO_LONGS(max(framesz->line, framesz->col)),
+			sizeof(long), GFP_KERNEL);
+	if(epd->dirty == NULL) {
+		err = -ENOMEM;
+		goto fail;
+	}
+	bitmap_fill(epd->dirty, framesz->line);
+
 	/* TODO Get dynamic id here */
 	epd->id = 0;
 	mutex_init(&epd->lock);
@@ -190,8 +728,8 @@ struct epd *epd_create(struct device *dev, struct epd_driver *drv)
 	if(err < 0)
 		goto fail;
 
-	edev = device_create(epddev_class, dev, EPD_DEVT(epd), epd,
-			"epd%u", epd->id);
+	edev = device_create_with_groups(epddev_class, dev, EPD_DEVT(epd), epd,
+			epd_groups, "epd%u", epd->id);
 	err = PTR_ERR_OR_ZERO(edev);
 	if(err < 0)
 		goto fail;
@@ -208,41 +746,251 @@ EXPORT_SYMBOL(epd_create);
 
 static void epd_update_frame(struct epd *epd)
 {
-	memcpy(epd->fold->data, epd->fnew->data,
-			epd->fold->nrline * epd->fold->bytes_per_line);
+	/* Do not overwrite a displayed slot */
+	epd->fold = epd->fbuf;
+	epd_frame_copy(epd->fold, epd->fnew);
+}
+
+static bool epd_frame_equal(struct epd_frame const *f1,
+		struct epd_frame const *f2)
+{
+	return f1->xform == f2->xform && f1->nrline == f2->nrline &&
+		memcmp(f1->data, f2->data, f1->nrline * f1->bytes_per_line) == 0;
+}
+
+/* Only dirty lines of new frame can differ from displayed frame */
+static bool epd_frame_changed(struct epd *epd)
+{
+	struct epd_frame const *fnew = epd->fnew, *fold = epd->fold;
+	size_t bpl = fnew->bytes_per_line;
+	unsigned int i;
+
+	if(fnew->xform != fold->xform || fnew->nrline != fold->nrline)
+		return true;
+
+	for(i = 0; i < fnew->nrline; ++i) {
+		if(test_bit(i, epd->dirty) && memcmp(fnew->data + i * bpl,
+					fold->data + i * bpl, bpl) != 0)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Skip an update if new frame is already displayed, that is no dirty line
+ * differs, return true if skipped
+ */
+static bool epd_skip_update(struct epd *epd, unsigned int kind)
+{
+	if(epd_frame_changed(epd))
+		return false;
+
+	DBG("Frame already displayed, skip update\n");
+	trace_epd_skip(epd->id, kind);
+	epd_stats_skip(epd);
+	epd_mark_clean(epd);
+	return true;
 }
 
-static int epd_draw_frame(struct epd *epd)
+int epd_sleep_until(ktime_t t)
+{
+	while(ktime_before(ktime_get(), t)) {
+		if(signal_pending(current))
+			return -EINTR;
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule_hrtimeout_range(&t, 0, HRTIMER_MODE_ABS);
+	}
+	return 0;
+}
+EXPORT_SYMBOL(epd_sleep_until);
+
+/*
+ * Wait, screen not locked yet, for a deadline draw to start: until driver lead
+ * time before deadline if it times its update itself, until deadline otherwise.
+ */
+static int epd_draw_wait(struct epd *epd, ktime_t deadline)
 {
 	struct epd_driver *drv = epd->drv;
+	u64 lead = 0;
+
+	if(deadline == 0)
+		return 0;
+
+	if(drv->ops.draw_frame_at != NULL) {
+		if(drv->ops.draw_lead == NULL)
+			return 0;
+		lead = drv->ops.draw_lead(drv);
+	}
+	return epd_sleep_until(ktime_sub(deadline, lead));
+}
+
+/*
+ * Draw new frame, so that it shows at deadline (CLOCK_MONOTONIC) if not zero,
+ * once epd_draw_wait() returned. Drivers that cannot time their update
+ * themselves get it started right away, deadline being already reached.
+ */
+static int epd_draw_frame_at(struct epd *epd, unsigned int flags,
+		ktime_t deadline)
+{
+	struct epd_driver *drv = epd->drv;
+	ktime_t start, shown = 0;
 	int ret = 0;
 
-	if(drv->ops.draw_frame != NULL)
-		ret = drv->ops.draw_frame(drv);
+	if(!(flags & EPD_DRAW_FORCE) && epd_skip_update(epd, EPD_TRACE_FRAME))
+		return 0;
+
+	trace_epd_commit(epd->id, EPD_TRACE_FRAME, deadline);
+	start = ktime_get();
+	if(deadline != 0 && drv->ops.draw_frame_at != NULL) {
+		ret = drv->ops.draw_frame_at(drv, deadline, &shown);
+	} else {
+		shown = ktime_get();
+		if(drv->ops.draw_frame != NULL)
+			ret = drv->ops.draw_frame(drv);
+	}
+
+	trace_epd_commit_done(epd->id, ret);
+	/* A failed update leaves frame dirty, so that it is drawn again */
+	if(ret < 0)
+		return ret;
+
+	epd_stats_update(epd, start);
+	if(deadline != 0) {
+		WRITE_ONCE(epd->deadline_latency,
+				ktime_to_ns(ktime_sub(shown, deadline)));
+		DBG("Frame shown %lld ns after deadline\n",
+				(long long)epd->deadline_latency);
+	}
 
 	/*
 	 * XXX Bad perf :-(.
 	 * Switch fold and fnew would cause read to not get current fb data
 	 */
 	epd_update_frame(epd);
+	epd_mark_clean(epd);
+	return 0;
+}
+
+static int epd_draw_frame(struct epd *epd, unsigned int flags)
+{
+	return epd_draw_frame_at(epd, flags, 0);
+}
+
+/*
+ * Fill new frame with pattern and draw it, letting driver use its solid frame
+ * fast path if any.
+ */
+static int epd_draw_fill(struct epd *epd, u8 pattern)
+{
+	struct epd_driver *drv = epd->drv;
+	ktime_t start;
+	int ret;
+
+	epd_frame_fill(epd->fnew, pattern);
+	epd_mark_dirty(epd, 0, epd->fnew->nrline);
+	if(drv->ops.draw_fill == NULL)
+		return epd_draw_frame(epd, 0);
+
+	if(epd_skip_update(epd, EPD_TRACE_FILL))
+		return 0;
+
+	trace_epd_commit(epd->id, EPD_TRACE_FILL, 0);
+	start = ktime_get();
+	ret = drv->ops.draw_fill(drv, pattern);
+	trace_epd_commit_done(epd->id, ret);
+	if(ret < 0)
+		return ret;
+
+	epd_stats_update(epd, start);
+	epd->fold = epd->fbuf;
+	epd_frame_set_geometry(epd->fold, epd->fnew->nrline, epd->fnew->nrdot,
+			epd->fnew->xform);
+	epd_frame_fill(epd->fold, pattern);
+	epd_mark_clean(epd);
 	return ret;
 }
 
+/*
+ * Display a preloaded frame slot. Slot is drawn in place of new frame and then
+ * becomes the displayed frame, without any frame copy.
+ */
+static int epd_draw_slot(struct epd *epd, unsigned int slot)
+{
+	struct epd_driver *drv = epd->drv;
+	struct epd_frame *fnew;
+	ktime_t start;
+	int ret = 0;
+
+	if(slot >= epd->nr_slots)
+		return -EINVAL;
+
+	if(epd->fold == epd->slots[slot] ||
+			epd_frame_equal(epd->slots[slot], epd->fold)) {
+		DBG("Frame already displayed, skip update\n");
+		trace_epd_skip(epd->id, EPD_TRACE_SLOT);
+		epd_stats_skip(epd);
+		return 0;
+	}
+
+	trace_epd_commit(epd->id, EPD_TRACE_SLOT, 0);
+	start = ktime_get();
+	fnew = epd->fnew;
+	epd->fnew = epd->slots[slot];
+	if(drv->ops.draw_frame != NULL)
+		ret = drv->ops.draw_frame(drv);
+	epd->fnew = fnew;
+	trace_epd_commit_done(epd->id, ret);
+	/* Panel still shows the old frame, so that slot is drawn again */
+	if(ret < 0)
+		return ret;
+
+	epd_stats_update(epd, start);
+	epd->fold = epd->slots[slot];
+	epd_mark_dirty(epd, 0, epd->fnew->nrline);
+	return 0;
+}
+
+/*
+ * Get the frame at offset off of framebuffer file, frame 0 being the new frame
+ * and the following ones the preloaded slots. Offset in frame is returned in
+ * foff.
+ */
+static struct epd_frame *epd_fb_frame(struct epd *epd, loff_t off,
+		size_t *foff)
+{
+	size_t bufsz = epd->fnew->nrline * epd->fnew->bytes_per_line;
+	loff_t idx;
+
+	if(off < 0)
+		return NULL;
+
+	idx = div_u64(off, bufsz);
+	*foff = off - idx * bufsz;
+	if(idx == 0)
+		return epd->fnew;
+	if(idx <= epd->nr_slots)
+		return epd->slots[idx - 1];
+	return NULL;
+}
+
 static ssize_t epd_fb_read(struct file *f, char __user *buf,
 		size_t len, loff_t *off)
 {
 	struct epd *epd;
-	size_t bufsz, sz;
+	struct epd_frame *frame;
+	size_t bufsz, sz, foff;
 	ssize_t ret = 0;
 
 	epd = f->private_data;
 	bufsz = epd->fnew->nrline * epd->fnew->bytes_per_line;
-	if(*off > (loff_t)bufsz)
+	frame = epd_fb_frame(epd, *off, &foff);
+	if(frame == NULL)
 		goto out;
 
-	sz = min_t(size_t, len, bufsz - *off);
-	mutex_lock(&epd->lock);
-	ret = copy_to_user(buf, epd->fnew->data + *off, sz);
+	/* Do not read across frames */
+	sz = min_t(size_t, len, bufsz - foff);
+	epd_lock(epd);
+	ret = copy_to_user(buf, frame->data + foff, sz);
 	mutex_unlock(&epd->lock);
 	if(ret < 0)
 		goto out;
@@ -252,29 +1000,45 @@ out:
 	return ret;
 }
 
-static ssize_t epd_fb_write(struct file *f, char const __user *buf,
-		size_t len, loff_t *off)
+/*
+ * Writes go through an iov_iter so that splice() and sendfile() can feed new
+ * frame or slots straight from page cache.
+ */
+static ssize_t epd_fb_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct epd *epd;
-	size_t bufsz;
-	long missing = 0;
+	struct epd_frame *frame;
+	size_t bufsz, foff, len = iov_iter_count(from), copied;
 	int ret = 0;
 
-	epd = f->private_data;
+	epd = iocb->ki_filp->private_data;
 	bufsz = epd->fnew->nrline * epd->fnew->bytes_per_line;
+	frame = epd_fb_frame(epd, iocb->ki_pos, &foff);
 
-	if(len + *off > bufsz) {
+	if(frame == NULL || len + foff > bufsz) {
 		ret = -EMSGSIZE;
 		goto out;
 	}
 
-	mutex_lock(&epd->lock);
-	missing = copy_from_user(epd->fnew->data + *off, buf, len);
-	if(missing != 0) {
+	epd_lock(epd);
+	/* Keep a copy of displayed frame when its slot is modified */
+	if(frame == epd->fold) {
+		epd_frame_copy(epd->fbuf, frame);
+		epd->fold = epd->fbuf;
+	}
+
+	copied = copy_from_iter(frame->data + foff, len, from);
+	if(frame == epd->fnew && copied != 0) {
+		epd_mark_dirty(epd, foff / frame->bytes_per_line,
+				(foff + copied - 1) / frame->bytes_per_line -
+				foff / frame->bytes_per_line + 1);
+		++epd->writes;
+	}
+	if(copied != len) {
 		ret = -EFAULT;
 		goto unlock;
 	}
-	*off += len;
+	iocb->ki_pos += len;
 	ret = len;
 unlock:
 	mutex_unlock(&epd->lock);
@@ -282,6 +1046,627 @@ out:
 	return ret;
 }
 
+/*
+ * Write w pixels from src into line at pixel x. src first pixel is its first
+ * byte bit 0.
+ */
+static void epd_line_blit(u8 *line, unsigned int x, u8 const *src,
+		unsigned int w)
+{
+	unsigned int sh = x % 8, nb = w / 8, rem = w % 8, i;
+	u8 *dst = line + x / 8;
+	u16 mask, v;
+
+	if(sh == 0) {
+		memcpy(dst, src, nb);
+	} else {
+		/* Each source byte spans two destination bytes */
+		mask = (1 << sh) - 1;
+		for(i = 0; i < nb; ++i) {
+			dst[i] = (dst[i] & mask) | (src[i] << sh);
+			dst[i + 1] = (dst[i + 1] & ~mask) | (src[i] >> (8 - sh));
+		}
+	}
+
+	if(rem == 0)
+		return;
+
+	/* Trailing pixels, that can also span two destination bytes */
+	mask = ((1 << rem) - 1) << sh;
+	v = (src[nb] << sh) & mask;
+	dst[nb] = (dst[nb] & ~mask) | v;
+	if(mask >> 8)
+		dst[nb + 1] = (dst[nb + 1] & ~(mask >> 8)) | (v >> 8);
+}
+
+/*
+ * Read w pixels of line from pixel x into dst, dst first pixel being its first
+ * byte bit 0.
+ */
+static void epd_line_extract(u8 *dst, u8 const *line, unsigned int x,
+		unsigned int w)
+{
+	unsigned int sh = x % 8, nb = DIV_ROUND_UP(w, 8), i;
+	u8 const *src = line + x / 8;
+	/* Last source byte holding rectangle pixels */
+	unsigned int last = (x + w - 1) / 8 - x / 8;
+
+	if(sh == 0) {
+		memcpy(dst, src, nb);
+		return;
+	}
+
+	for(i = 0; i < nb; ++i) {
+		dst[i] = src[i] >> sh;
+		if(i + 1 <= last)
+			dst[i] |= src[i + 1] << (8 - sh);
+	}
+}
+
+enum epd_rop {
+	EPD_ROP_CLEAR,
+	EPD_ROP_SET,
+	EPD_ROP_INVERT,
+};
+
+static inline u8 epd_rop_byte(u8 d, u8 mask, enum epd_rop rop)
+{
+	switch(rop) {
+	case EPD_ROP_CLEAR:
+		return d & ~mask;
+	case EPD_ROP_SET:
+		return d | mask;
+	default:
+		return d ^ mask;
+	}
+}
+
+static inline unsigned long epd_rop_long(unsigned long d, enum epd_rop rop)
+{
+	switch(rop) {
+	case EPD_ROP_CLEAR:
+		return 0;
+	case EPD_ROP_SET:
+		return ~0UL;
+	default:
+		return ~d;
+	}
+}
+
+/*
+ * Apply rop on w pixels of line from pixel x. Partial bytes are masked, bytes
+ * are then processed one at a time up to the first aligned word, and the span
+ * middle a word at a time.
+ */
+static void epd_line_rop(u8 *line, unsigned int x, unsigned int w,
+		enum epd_rop rop)
+{
+	u8 *p = line + x / 8, *end = line + (x + w) / 8;
+	unsigned int sh = x % 8, tail = (x + w) % 8;
+	unsigned long *wp;
+
+	/* Span is inside a single byte */
+	if(p == end) {
+		*p = epd_rop_byte(*p, ((1 << w) - 1) << sh, rop);
+		return;
+	}
+
+	if(sh != 0) {
+		*p = epd_rop_byte(*p, 0xff << sh, rop);
+		++p;
+	}
+
+	for(; p < end && !IS_ALIGNED((unsigned long)p, sizeof(long)); ++p)
+		*p = epd_rop_byte(*p, 0xff, rop);
+
+	for(wp = (unsigned long *)p; (u8 *)(wp + 1) <= end; ++wp)
+		*wp = epd_rop_long(*wp, rop);
+
+	for(p = (u8 *)wp; p < end; ++p)
+		*p = epd_rop_byte(*p, 0xff, rop);
+
+	if(tail != 0)
+		*end = epd_rop_byte(*end, (1 << tail) - 1, rop);
+}
+
+/* Pixels positions are unknown in native frames */
+static bool epd_rect_valid(struct epd_frame const *frame, u32 x, u32 y,
+		u32 w, u32 h)
+{
+	return !(frame->xform & EPD_XFORM_NATIVE) && w != 0 && h != 0 &&
+		x < frame->nrdot && y < frame->nrline &&
+		w <= frame->nrdot - x && h <= frame->nrline - y;
+}
+
+static int epd_ioctl_blit(struct epd *epd, void __user *argp)
+{
+	struct epd_frame *fnew = epd->fnew;
+	struct epd_blit b;
+	u8 __user *src;
+	u8 *buf;
+	size_t len;
+	unsigned int i;
+	int ret = 0;
+
+	if(copy_from_user(&b, argp, sizeof(b)))
+		return -EFAULT;
+
+	len = DIV_ROUND_UP(b.w, 8);
+	if(!epd_rect_valid(fnew, b.x, b.y, b.w, b.h) || b.stride < len)
+		return -EINVAL;
+
+	buf = kmalloc(len, GFP_KERNEL);
+	if(buf == NULL)
+		return -ENOMEM;
+
+	src = u64_to_user_ptr(b.data);
+	epd_lock(epd);
+	for(i = 0; i < b.h; ++i) {
+		if(copy_from_user(buf, src + i * b.stride, len)) {
+			ret = -EFAULT;
+			break;
+		}
+		epd_line_blit(fnew->data + (b.y + i) * fnew->bytes_per_line,
+				b.x, buf, b.w);
+	}
+	epd_mark_dirty(epd, b.y, i);
+	++epd->writes;
+
+	if(ret == 0 && (b.flags & EPD_RECT_DRAW))
+		ret = epd_draw_frame(epd, 0);
+	mutex_unlock(&epd->lock);
+
+	kfree(buf);
+	return ret;
+}
+
+static int epd_ioctl_rop(struct epd *epd, void __user *argp, bool invert)
+{
+	struct epd_frame *fnew = epd->fnew;
+	struct epd_rect r;
+	enum epd_rop rop;
+	unsigned int i;
+	int ret = 0;
+
+	if(copy_from_user(&r, argp, sizeof(r)))
+		return -EFAULT;
+
+	if(!epd_rect_valid(fnew, r.x, r.y, r.w, r.h))
+		return -EINVAL;
+
+	if(invert)
+		rop = EPD_ROP_INVERT;
+	else
+		rop = r.color ? EPD_ROP_SET : EPD_ROP_CLEAR;
+
+	epd_lock(epd);
+	for(i = 0; i < r.h; ++i)
+		epd_line_rop(fnew->data + (r.y + i) * fnew->bytes_per_line,
+				r.x, r.w, rop);
+	epd_mark_dirty(epd, r.y, r.h);
+	++epd->writes;
+
+	if(r.flags & EPD_RECT_DRAW)
+		ret = epd_draw_frame(epd, 0);
+	mutex_unlock(&epd->lock);
+
+	return ret;
+}
+
+static int epd_ioctl_copy(struct epd *epd, void __user *argp)
+{
+	struct epd_frame *fnew = epd->fnew;
+	size_t bpl = fnew->bytes_per_line;
+	struct epd_copy c;
+	unsigned int i, l;
+	u8 *buf;
+	int ret = 0;
+
+	if(copy_from_user(&c, argp, sizeof(c)))
+		return -EFAULT;
+
+	if(!epd_rect_valid(fnew, c.x, c.y, c.w, c.h) ||
+			!epd_rect_valid(fnew, c.sx, c.sy, c.w, c.h))
+		return -EINVAL;
+
+	buf = kmalloc(bpl, GFP_KERNEL);
+	if(buf == NULL)
+		return -ENOMEM;
+
+	epd_lock(epd);
+	/*
+	 * Each line goes through buf, so horizontal overlap is safe, and lines
+	 * are copied bottom up when moving down so that vertical overlap is.
+	 */
+	for(i = 0; i < c.h; ++i) {
+		l = (c.y > c.sy) ? c.h - 1 - i : i;
+		epd_line_extract(buf, fnew->data + (c.sy + l) * bpl, c.sx, c.w);
+		epd_line_blit(fnew->data + (c.y + l) * bpl, c.x, buf, c.w);
+	}
+	epd_mark_dirty(epd, c.y, c.h);
+	++epd->writes;
+
+	if(c.flags & EPD_RECT_DRAW)
+		ret = epd_draw_frame(epd, 0);
+	mutex_unlock(&epd->lock);
+
+	kfree(buf);
+	return ret;
+}
+
+static int epd_ioctl_encoded(struct epd *epd, void __user *argp)
+{
+	struct epd_driver *drv = epd->drv;
+	struct epd_encoded e;
+	ktime_t start;
+	void *buf;
+	int ret;
+
+	if(copy_from_user(&e, argp, sizeof(e)))
+		return -EFAULT;
+
+	if(drv->ops.draw_encoded == NULL)
+		return -EOPNOTSUPP;
+
+	if(e.len == 0 || e.len > EPD_MAX_ENCODED_SZ)
+		return -EINVAL;
+
+	buf = vmalloc(e.len);
+	if(buf == NULL)
+		return -ENOMEM;
+
+	if(copy_from_user(buf, u64_to_user_ptr(e.data), e.len)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	epd_lock(epd);
+	trace_epd_commit(epd->id, EPD_TRACE_ENCODED, 0);
+	start = ktime_get();
+	ret = drv->ops.draw_encoded(drv, buf, e.len);
+	trace_epd_commit_done(epd->id, ret);
+	/* New frame may have been set even on failure */
+	epd_mark_dirty(epd, 0, epd->fnew->nrline);
+	if(ret == 0) {
+		epd_stats_update(epd, start);
+		epd_update_frame(epd);
+		epd_mark_clean(epd);
+	}
+	mutex_unlock(&epd->lock);
+
+out:
+	vfree(buf);
+	return ret;
+}
+
+static unsigned int epd_submit_flags(u32 flags)
+{
+	return (flags & EPD_SUBMIT_FORCE) ? EPD_DRAW_FORCE : 0;
+}
+
+/*
+ * Write and draw a whole new frame under a single lock, so that no other write
+ * can interleave between them.
+ */
+static int epd_ioctl_submit(struct epd *epd, void __user *argp)
+{
+	struct epd_frame *fnew = epd->fnew;
+	struct epd_submit sub;
+	int ret;
+
+	if(copy_from_user(&sub, argp, sizeof(sub)))
+		return -EFAULT;
+
+	if(sub.len != fnew->nrline * fnew->bytes_per_line)
+		return -EMSGSIZE;
+
+	epd_lock(epd);
+	ret = copy_from_user(fnew->data, u64_to_user_ptr(sub.data), sub.len);
+	epd_mark_dirty(epd, 0, fnew->nrline);
+	if(ret != 0) {
+		ret = -EFAULT;
+		goto unlock;
+	}
+
+	ret = epd_draw_frame(epd, epd_submit_flags(sub.flags));
+unlock:
+	mutex_unlock(&epd->lock);
+	return ret;
+}
+
+/* Get a draw deadline as a CLOCK_MONOTONIC time, 0 for none */
+static int epd_draw_deadline(struct epd_draw const *draw, ktime_t *deadline)
+{
+	*deadline = 0;
+	if(!(draw->flags & EPD_SUBMIT_DEADLINE))
+		return 0;
+
+	switch(draw->clock) {
+	case CLOCK_MONOTONIC:
+		*deadline = ns_to_ktime(draw->deadline_ns);
+		break;
+	case CLOCK_REALTIME:
+		*deadline = ktime_sub(ns_to_ktime(draw->deadline_ns),
+				ktime_sub(ktime_get_real(), ktime_get()));
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* Deadline is waited for, do not let it be arbitrary far */
+	if(ktime_after(*deadline, ktime_add_ms(ktime_get(), EPD_DEADLINE_MAX_MS)))
+		return -ERANGE;
+
+	/* Keep 0 for no deadline */
+	if(*deadline == 0)
+		*deadline = 1;
+	return 0;
+}
+
+static int epd_ioctl_draw(struct epd *epd, void __user *argp)
+{
+	struct epd_draw draw;
+	ktime_t deadline;
+	int ret;
+
+	if(copy_from_user(&draw, argp, sizeof(draw)))
+		return -EFAULT;
+
+	ret = epd_draw_deadline(&draw, &deadline);
+	if(ret < 0)
+		return ret;
+
+	ret = epd_draw_wait(epd, deadline);
+	if(ret < 0)
+		return ret;
+
+	epd_lock(epd);
+	ret = epd_draw_frame_at(epd, epd_submit_flags(draw.flags), deadline);
+	mutex_unlock(&epd->lock);
+	return ret;
+}
+
+/*
+ * Submission ring layout is: header, submission entries, completion entries
+ * and then frames, starting on a page boundary.
+ */
+#define EPD_RING_SQ_OFF ALIGN(sizeof(struct epd_ring_hdr), 64)
+#define EPD_RING_CQ_OFF(n) (EPD_RING_SQ_OFF + (n) * sizeof(struct epd_ring_sqe))
+#define EPD_RING_FRAMES_OFF(n)						\
+	PAGE_ALIGN(EPD_RING_CQ_OFF(n) + (n) * sizeof(struct epd_ring_cqe))
+
+static struct epd_ring_sqe *epd_ring_sqe(struct epd *epd, u32 idx)
+{
+	struct epd_ring_sqe *sqes = (void *)epd->ring + EPD_RING_SQ_OFF;
+
+	return &sqes[idx & (epd->ring_entries - 1)];
+}
+
+static struct epd_ring_cqe *epd_ring_cqe(struct epd *epd, u32 idx)
+{
+	struct epd_ring_cqe *cqes = (void *)epd->ring +
+		EPD_RING_CQ_OFF(epd->ring_entries);
+
+	return &cqes[idx & (epd->ring_entries - 1)];
+}
+
+static int epd_ioctl_predict(struct epd *epd, void __user *argp)
+{
+	struct epd_driver *drv = epd->drv;
+	struct epd_predict p;
+	u64 duration, shown;
+	int powered, ret;
+
+	if(copy_from_user(&p, argp, sizeof(p)))
+		return -EFAULT;
+
+	if(drv->ops.predict == NULL)
+		return -EOPNOTSUPP;
+
+	switch(p.power) {
+	case EPD_PREDICT_NOW:
+		powered = -1;
+		break;
+	case EPD_PREDICT_COLD:
+		powered = 0;
+		break;
+	case EPD_PREDICT_HOT:
+		powered = 1;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	ret = drv->ops.predict(drv, powered, &duration, &shown);
+	if(ret < 0)
+		return ret;
+
+	p.duration_ns = duration;
+	p.shown_ns = shown;
+	if(copy_to_user(argp, &p, sizeof(p)))
+		return -EFAULT;
+	return 0;
+}
+
+static int epd_ioctl_ring_setup(struct epd *epd, void __user *argp)
+{
+	struct epd_frame *fnew = epd->fnew;
+	struct epd_ring_setup setup;
+	size_t fsz = fnew->nrline * fnew->bytes_per_line, sz;
+	int ret = 0;
+
+	if(copy_from_user(&setup, argp, sizeof(setup)))
+		return -EFAULT;
+
+	if(setup.entries == 0 || setup.entries > EPD_RING_MAX_ENTRIES ||
+			!is_power_of_2(setup.entries))
+		return -EINVAL;
+
+	sz = PAGE_ALIGN(EPD_RING_FRAMES_OFF(setup.entries) +
+			setup.entries * fsz);
+
+	epd_lock(epd);
+	/* An existing ring can only be mapped again */
+	if(epd->ring != NULL) {
+		if(epd->ring_entries != setup.entries)
+			ret = -EBUSY;
+		goto out;
+	}
+
+	epd->ring = vmalloc_user(sz);
+	if(epd->ring == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	/* Header is user writable, ring_entries is the only one trusted */
+	epd->ring->entries = setup.entries;
+	epd->ring_entries = setup.entries;
+	epd->ring_sz = sz;
+	epd->ring_frame_sz = fsz;
+	epd->ring_sq_head = 0;
+	epd->ring_cq_tail = 0;
+out:
+	if(ret == 0) {
+		setup.frame_sz = epd->ring_frame_sz;
+		setup.sq_off = EPD_RING_SQ_OFF;
+		setup.cq_off = EPD_RING_CQ_OFF(setup.entries);
+		setup.frames_off = EPD_RING_FRAMES_OFF(setup.entries);
+		setup.size = epd->ring_sz;
+	}
+	mutex_unlock(&epd->lock);
+
+	if(ret == 0 && copy_to_user(argp, &setup, sizeof(setup)))
+		ret = -EFAULT;
+	return ret;
+}
+
+static int epd_ring_run(struct epd *epd, struct epd_ring_sqe const *sqe)
+{
+	struct epd_frame *fnew = epd->fnew;
+	u8 const *frames = (void *)epd->ring +
+		EPD_RING_FRAMES_OFF(epd->ring_entries);
+
+	if(sqe->flags & EPD_RING_SLOT)
+		return epd_draw_slot(epd, sqe->frame);
+
+	if(sqe->frame >= epd->ring_entries)
+		return -EINVAL;
+
+	/* Geometry may have changed since ring setup */
+	if(fnew->nrline * fnew->bytes_per_line != epd->ring_frame_sz)
+		return -EMSGSIZE;
+
+	memcpy(fnew->data, frames + sqe->frame * epd->ring_frame_sz,
+			epd->ring_frame_sz);
+	epd_mark_dirty(epd, 0, fnew->nrline);
+	return epd_draw_frame(epd, epd_submit_flags(sqe->flags));
+}
+
+/*
+ * Consume submission ring entries in order. Ring indexes are shared with
+ * userspace, so kernel owned ones are only read from their private copy.
+ * Consumption stops when completion ring is full or on an entry to be
+ * displayed later, until next kick.
+ */
+static void epd_ring_work(struct work_struct *work)
+{
+	struct epd *epd = container_of(work, struct epd, ring_work);
+	struct epd_ring_hdr *hdr = epd->ring;
+	struct epd_ring_sqe sqe;
+	struct epd_ring_cqe *cqe;
+	u64 now;
+	int ret;
+
+	while(epd->ring_sq_head != smp_load_acquire(&hdr->sq_tail)) {
+		if(epd->ring_cq_tail - smp_load_acquire(&hdr->cq_head) >=
+				epd->ring_entries)
+			break;
+
+		memcpy(&sqe, epd_ring_sqe(epd, epd->ring_sq_head), sizeof(sqe));
+		now = ktime_get_ns();
+		if(sqe.time_ns > now) {
+			mod_delayed_work(system_long_wq, &epd->ring_wait,
+					nsecs_to_jiffies(sqe.time_ns - now));
+			break;
+		}
+
+		trace_epd_ring_sqe(epd->id, sqe.user_data, sqe.frame, sqe.flags,
+				sqe.time_ns);
+		epd_lock(epd);
+		ret = epd_ring_run(epd, &sqe);
+		mutex_unlock(&epd->lock);
+		trace_epd_ring_cqe(epd->id, sqe.user_data, ret);
+
+		cqe = epd_ring_cqe(epd, epd->ring_cq_tail);
+		cqe->user_data = sqe.user_data;
+		cqe->time_ns = ktime_get_ns();
+		cqe->res = ret;
+		smp_store_release(&hdr->cq_tail, ++epd->ring_cq_tail);
+		smp_store_release(&hdr->sq_head, ++epd->ring_sq_head);
+	}
+}
+
+static void epd_ring_wait(struct work_struct *work)
+{
+	struct epd *epd = container_of(to_delayed_work(work), struct epd,
+			ring_wait);
+
+	queue_work(system_long_wq, &epd->ring_work);
+}
+
+static int epd_ioctl_ring_kick(struct epd *epd)
+{
+	if(epd->ring == NULL)
+		return -ENODEV;
+
+	queue_work(system_long_wq, &epd->ring_work);
+	return 0;
+}
+
+static int epd_fb_mmap(struct file *f, struct vm_area_struct *vma)
+{
+	struct epd *epd = f->private_data;
+
+	if(epd->ring == NULL)
+		return -ENODEV;
+
+	if(vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > epd->ring_sz)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, epd->ring, 0);
+}
+
+static long epd_fb_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
+{
+	struct epd *epd = f->private_data;
+	void __user *argp = (void __user *)arg;
+
+	switch(cmd) {
+	case EPD_IOC_BLIT:
+		return epd_ioctl_blit(epd, argp);
+	case EPD_IOC_FILL:
+		return epd_ioctl_rop(epd, argp, false);
+	case EPD_IOC_INVERT:
+		return epd_ioctl_rop(epd, argp, true);
+	case EPD_IOC_COPY:
+		return epd_ioctl_copy(epd, argp);
+	case EPD_IOC_DRAW_ENCODED:
+		return epd_ioctl_encoded(epd, argp);
+	case EPD_IOC_SUBMIT:
+		return epd_ioctl_submit(epd, argp);
+	case EPD_IOC_DRAW:
+		return epd_ioctl_draw(epd, argp);
+	case EPD_IOC_RING_SETUP:
+		return epd_ioctl_ring_setup(epd, argp);
+	case EPD_IOC_RING_KICK:
+		return epd_ioctl_ring_kick(epd);
+	case EPD_IOC_PREDICT:
+		return epd_ioctl_predict(epd, argp);
+	default:
+		return -ENOTTY;
+	}
+}
+
 static int epd_fb_open(struct inode *i, struct file *f)
 {
 	struct epd *epd;
@@ -311,9 +1696,12 @@ static int epd_fb_release(struct inode *i, struct file *f)
 static struct file_operations const epd_fb_ops = {
 	.owner = THIS_MODULE,
 	.read = epd_fb_read,
-	.write = epd_fb_write,
+	.write_iter = epd_fb_write_iter,
+	.splice_write = iter_file_splice_write,
 	.open = epd_fb_open,
 	.release = epd_fb_release,
+	.unlocked_ioctl = epd_fb_ioctl,
+	.mmap = epd_fb_mmap,
 	.llseek = default_llseek,
 };
 
@@ -323,7 +1711,7 @@ static ssize_t epd_ctl_write(struct file *f, char const __user *buf,
 	struct epd *epd;
 	char *msg;
 	int ret = -EINVAL;
-	unsigned int eid;
+	unsigned int eid, arg;
 	u8 cmd;
 
 	if(len < 2)
@@ -342,10 +1730,14 @@ static ssize_t epd_ctl_write(struct file *f, char const __user *buf,
 	}
 	msg[len] = '\0';
 
-	/* Get cmd and epd id */
-	ret = sscanf(msg, "%c%u", &cmd, &eid);
+	/* Get cmd, epd id and optional argument */
+	ret = sscanf(msg, "%c%u %u", &cmd, &eid, &arg);
 	kfree(msg);
-	if(ret != 2) {
+	if(ret < 2) {
+		ret = -EINVAL;
+		goto out;
+	}
+	if(ret < 3 && cmd == EPD_CTL_SLOT) {
 		ret = -EINVAL;
 		goto out;
 	}
@@ -356,18 +1748,23 @@ static ssize_t epd_ctl_write(struct file *f, char const __user *buf,
 		goto out;
 
 	ret = len;
-	mutex_lock(&epd->lock);
+	epd_lock(epd);
 	switch(cmd) {
 	case 'C':
-		epd_frame_white(epd->fnew);
-		epd_draw_frame(epd);
+		epd_draw_fill(epd, 0x00);
 		break;
 	case 'B':
-		epd_frame_black(epd->fnew);
-		epd_draw_frame(epd);
+		epd_draw_fill(epd, 0xff);
 		break;
 	case 'W':
-		epd_draw_frame(epd);
+		epd_draw_frame(epd, 0);
+		break;
+	case 'F':
+		epd_draw_frame(epd, EPD_DRAW_FORCE);
+		break;
+	case 'S':
+		if(epd_draw_slot(epd, arg) == -EINVAL)
+			ret = -EINVAL;
 		break;
 	default:
 		ret = -EINVAL;
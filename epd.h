@@ -1,6 +1,7 @@
 #ifndef _EPD_H_
 #define _EPD_H_
 
+struct device;
 struct epd_driver;
 
 struct epd_frame_size {
@@ -8,21 +9,73 @@ struct epd_frame_size {
 	size_t col;
 };
 
+/*
+ * Frame transforms to apply to get panel pixels, in this order. Transposed
+ * frame geometry is swapped compared to panel one.
+ */
+#define EPD_XFORM_TRANSPOSE (1 << 0)
+#define EPD_XFORM_VFLIP (1 << 1)
+#define EPD_XFORM_HFLIP (1 << 2)
+#define EPD_XFORM_INVERT (1 << 3)
+/* Frame is in driver native layout, no other transform applies */
+#define EPD_XFORM_NATIVE (1 << 4)
+
+/**
+ * struct epd_frame - 1 bit per pixel frame
+ * @nrline: number of lines
+ * @nrdot: number of pixels per line
+ * @bytes_per_line: line size in bytes, pixel x being bit (x % 8) of byte x / 8
+ * @xform: EPD_XFORM_* transforms from frame to panel pixels
+ * @data: frame pixels
+ */
 struct epd_frame {
 	size_t nrline;
 	size_t nrdot;
 	unsigned int bytes_per_line;
+	unsigned int xform;
 	u8 data[];
 };
 
+/**
+ * struct epd_ops - epaper display driver operations
+ * @draw_frame: display the alternative framebuffer
+ * @draw_fill: optional, display an alternative framebuffer known to be filled
+ * with @pattern bytes
+ * @draw_encoded: optional, display a driver specific pre-encoded update, that
+ * also sets the alternative framebuffer
+ * @draw_frame_at: optional, display the alternative framebuffer so that it
+ * shows at @deadline (CLOCK_MONOTONIC), setting @shown to when it actually did
+ * @predict: optional, predict the alternative framebuffer drawing @duration
+ * and when it starts to show (@shown), both in ns, panel being powered or not
+ * as now if @powered is negative
+ * @draw_lead: optional, time in ns before a @draw_frame_at deadline it has to
+ * be called at, the screen not being locked while waiting for it
+ */
 struct epd_ops {
 	int (*draw_frame)(struct epd_driver *drv);
+	int (*draw_frame_at)(struct epd_driver *drv, ktime_t deadline,
+			ktime_t *shown);
+	int (*draw_fill)(struct epd_driver *drv, u8 pattern);
+	int (*draw_encoded)(struct epd_driver *drv, void const *buf,
+			size_t len);
+	int (*predict)(struct epd_driver *drv, int powered, u64 *duration,
+			u64 *shown);
+	u64 (*draw_lead)(struct epd_driver *drv);
 };
 
+/**
+ * struct epd_driver - epaper display driver description
+ * @name: driver name
+ * @desc: driver description
+ * @framesz: panel frame geometry
+ * @xforms: EPD_XFORM_* frame transforms the driver handles
+ * @ops: driver operations
+ */
 struct epd_driver {
 	char const *name;
 	char const *desc;
 	struct epd_frame_size const *framesz;
+	unsigned int xforms;
 	struct epd_ops ops;
 };
 
@@ -34,6 +87,14 @@ struct epd;
  */
 struct epd_frame *epd_get_cur_fb(struct epd *epd);
 
+/**
+ * epd_get_id - Get screen id
+ * @epd: epaper display driver to get id from
+ *
+ * Return the id of /dev/epd<id>, as traced by epd events.
+ */
+unsigned int epd_get_id(struct epd *epd);
+
 /**
  * epd_get_alt_fb - Get alternative framebuffer.
  * @epd: epaper display driver to get framebuffer form
@@ -43,6 +104,24 @@ struct epd_frame *epd_get_cur_fb(struct epd *epd);
  */
 struct epd_frame *epd_get_alt_fb(struct epd *epd);
 
+/**
+ * epd_frame_transpose - Transpose a frame
+ * @src: frame to transpose
+ * @dst: frame to write transposed @src into, large enough to hold it
+ *
+ * @dst geometry is @src one swapped and its transforms are @src ones without
+ * EPD_XFORM_TRANSPOSE.
+ */
+void epd_frame_transpose(struct epd_frame const *src, struct epd_frame *dst);
+
+/**
+ * epd_sleep_until - Sleep on a hrtimer until a time is reached
+ * @t: CLOCK_MONOTONIC time to wake up at
+ *
+ * Return 0, or -EINTR if a signal interrupted the sleep.
+ */
+int epd_sleep_until(ktime_t t);
+
 /**
  * epd_create - Create a new epaper display driver
  * @dev: Parent device
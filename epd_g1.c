@@ -1,19 +1,35 @@
 #include <linux/module.h>
 #include <linux/err.h>
 #include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/overflow.h>
+#include <linux/debugfs.h>
+#include <linux/uaccess.h>
 #include <linux/pwm.h>
 #include <linux/spi/spi.h>
 #include <linux/i2c.h>
 #include <linux/gpio.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/bitrev.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/of_gpio.h>
 
 #include "epd.h"
 #include "epd_g1.h"
+#include "epd_g1_enc.h"
 #include "epd_therm.h"
 
+#define CREATE_TRACE_POINTS
+#include "epd_g1_trace.h"
+
 #ifdef DEBUG
 #define DBG(...) printk("epd: "__VA_ARGS__)
 #else
@@ -30,25 +46,111 @@
 #define PWM_DUTY_PERCENT 50
 #define PWM_DUTY (PWM_PERIOD * PWM_DUTY_PERCENT / 100)
 
-#define G1_DOT_NRBIT 2
-#define G1_DOT_PER_BYTE (8 / G1_DOT_NRBIT)
-#define G1_DOT_B 3
-#define G1_DOT_W 2
-#define G1_DOT_N 1
-#define G1_SCAN_NRBIT 2
-#define G1_SCAN_PER_BYTE (8 / G1_SCAN_NRBIT)
-#define G1_SCAN_OFF 0
-#define G1_SCAN_ON 3
-#define G1_DUMMY_LINE ((size_t)(-1))
+static unsigned int hot_timeout_ms;
+module_param(hot_timeout_ms, uint, 0444);
+MODULE_PARM_DESC(hot_timeout_ms,
+		"Default idle time before powering panel off (0: after each update)");
+
+static unsigned int stage_cache_kb = 512;
+module_param(stage_cache_kb, uint, 0444);
+MODULE_PARM_DESC(stage_cache_kb,
+		"Memory used to cache encoded stages of recent updates in KiB");
+
+static unsigned int capture_kb;
+module_param(capture_kb, uint, 0444);
+MODULE_PARM_DESC(capture_kb,
+		"SPI and GPIO capture ring size per panel in KiB (0: no capture)");
+
+static struct dentry *g1_debugfs;
+
+/*
+ * Frame preparation steps, run while the panel power sequence settles. Encoding
+ * steps are numbered after the stage they encode.
+ */
+#define G1_PREP_THERM 0
+#define G1_PREP_LOOKUP 1
+#define G1_PREP_STAGE(s) ((s) + 2)
+#define G1_PREP_DONE G1_PREP_STAGE(G1_STAGE_POWEROFF)
+
+/*
+ * Time needed, before the first stage of a deadline update, to power the panel
+ * on and prepare the frame
+ */
+#define G1_DEADLINE_LEAD_MS 200
+
+/*
+ * Encoded drawing stages of an update, kept in a LRU cache keyed by the
+ * displayed and new frames. Frame copies are kept to check for hash
+ * collisions.
+ */
+struct g1_stages {
+	struct list_head next;
+	u64 key;
+	bool valid;
+	unsigned int fold_xform;
+	unsigned int fnew_xform;
+	u8 *fold;
+	u8 *fnew;
+	u8 *data[G1_STAGE_POWEROFF];
+};
+
+/**
+ * struct g1_stats - Panel statistics, reset by the stats/reset attribute
+ * @stage_ns: total time spent drawing each stage
+ * @passes: total number of passes of each stage
+ * @spi_bytes: bytes sent on spi bus
+ * @spi_xfers: spi transfers
+ * @busy_ns: total time spent waiting for the COG busy line
+ */
+struct g1_stats {
+	u64 stage_ns[G1_STAGE_NR];
+	u64 passes[G1_STAGE_NR];
+	u64 spi_bytes;
+	u64 spi_xfers;
+	u64 busy_ns;
+};
 
 struct g1 {
 	struct epd *epd;
+	unsigned int id;
 	struct spi_device *spi;
 	struct i2c_client *therm;
 	struct pwm_device *pwm;
 	struct epd_driver drv;
 	enum g1_screen_type type;
+	struct mutex lock;
+	struct mutex hw_lock;
+	struct delayed_work poweroff_work;
+	unsigned int hot_timeout;
+	bool powered;
+	struct g1_temp_point temp_curve[G1_TEMP_CURVE_MAX];
+	size_t temp_curve_len;
+	unsigned int stage_time_scale;
 	unsigned long stage_time;
+	int temp;
+	bool temp_valid;
+	u64 pass_time;
+	unsigned int passes;
+	size_t line_sz;
+	struct list_head stage_cache;
+	size_t stage_cache_nr;
+	unsigned long stage_cache_hits;
+	unsigned long stage_cache_misses;
+	struct g1_stats stats;
+	struct dentry *debugfs;
+	spinlock_t cap_lock;
+	struct g1_capture_rec *cap;
+	size_t cap_nr;
+	u64 cap_start;
+	u64 cap_seq;
+	struct g1_stages *stages;
+	struct g1_stages *encoded;
+	struct epd_frame *src_old;
+	struct epd_frame *src_new;
+	struct epd_frame *tframe[2];
+	u8 *poweroff_data;
+	unsigned int prep;
+	int fill;
 	int gpio_panel_on;
 	int gpio_reset;
 	int gpio_border;
@@ -57,63 +159,147 @@ struct g1 {
 };
 #define g1_from_epd_drv(drv) (container_of(drv, struct g1, drv))
 
-static struct epd_frame_size const g1_frame_info[] = {
+/*
+ * Default temperature curve, it follows Pervasive Display's stage time
+ * temperature bands. Factors are in percent of the base stage time (e.g. 1700
+ * is 17 times the base stage time at -10C and below, 70 is 0.7 times above
+ * 40C).
+ */
+static struct g1_temp_point const g1_default_curve[] = {
+	{ .temp = -10000, .factor = 1700 },
+	{ .temp = -9999, .factor = 1200 },
+	{ .temp = -5000, .factor = 1200 },
+	{ .temp = -4999, .factor = 800 },
+	{ .temp = 5000, .factor = 800 },
+	{ .temp = 5001, .factor = 400 },
+	{ .temp = 10000, .factor = 400 },
+	{ .temp = 10001, .factor = 300 },
+	{ .temp = 15000, .factor = 300 },
+	{ .temp = 15001, .factor = 200 },
+	{ .temp = 20000, .factor = 200 },
+	{ .temp = 20001, .factor = 100 },
+	{ .temp = 40000, .factor = 100 },
+	{ .temp = 40001, .factor = 70 },
+};
+
+struct g1_temp_profile {
+	unsigned long stage_time;
+	struct g1_temp_point const *curve;
+	size_t curve_len;
+};
+
+static struct g1_temp_profile const g1_temp_profile[] = {
 	[G1_TYPE_1_44] = {
-		.line = 96,
-		.col = 128,
+		.stage_time = 480,
+		.curve = g1_default_curve,
+		.curve_len = ARRAY_SIZE(g1_default_curve),
 	},
 	[G1_TYPE_2] = {
-		.line = 96,
-		.col = 200,
+		.stage_time = 480,
+		.curve = g1_default_curve,
+		.curve_len = ARRAY_SIZE(g1_default_curve),
 	},
 	[G1_TYPE_2_7] = {
-		.line = 176,
-		.col = 264,
+		.stage_time = 630,
+		.curve = g1_default_curve,
+		.curve_len = ARRAY_SIZE(g1_default_curve),
 	},
 };
 
-enum g1_stage {
-	G1_STAGE_COMPENSATE,
-	G1_STAGE_WHITE,
-	G1_STAGE_INVERSE,
-	G1_STAGE_NORMAL,
-	G1_STAGE_POWEROFF,
-};
+#define G1_TEMP_FACTOR_MAX 5000
+#define G1_STAGE_TIME_SCALE_MAX 1000
 
-static void g1_compute_stage_time(struct g1 *g1)
+/*
+ * Check that curve has a valid number of points, sorted by strictly increasing
+ * temperature, and with non null factors.
+ */
+static int g1_temp_curve_check(struct g1_temp_point const *curve, size_t len)
 {
-	unsigned long stage_time = 0;
-	int temp;
+	size_t i;
 
-	switch(g1->type) {
-	case G1_TYPE_1_44:
-	case G1_TYPE_2:
-		stage_time = 480;
-		break;
-	case G1_TYPE_2_7:
-		stage_time = 630;
-		break;
+	if(len == 0 || len > G1_TEMP_CURVE_MAX)
+		return -EINVAL;
+
+	for(i = 0; i < len; ++i) {
+		if(curve[i].factor == 0 || curve[i].factor > G1_TEMP_FACTOR_MAX)
+			return -EINVAL;
+		if(i > 0 && curve[i].temp <= curve[i - 1].temp)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Get stage time factor in percent for temperature temp (in mC), rounded up.
+ * Computed on 64 bits as a user curve can span the whole int temperature
+ * range, factors being positive so is the interpolation.
+ */
+static unsigned int g1_temp_factor(struct g1_temp_point const *curve,
+		size_t len, int temp)
+{
+	struct g1_temp_point const *p0, *p1;
+	s64 num, den;
+	size_t i;
+
+	if(temp <= curve[0].temp)
+		return curve[0].factor;
+
+	for(i = 1; i < len; ++i) {
+		if(temp > curve[i].temp)
+			continue;
+
+		p0 = &curve[i - 1];
+		p1 = &curve[i];
+		den = (s64)p1->temp - p0->temp;
+		num = (s64)p0->factor * den +
+			((s64)p1->factor - (s64)p0->factor) *
+			((s64)temp - p0->temp);
+		return DIV64_U64_ROUND_UP(num, den);
 	}
 
+	return curve[len - 1].factor;
+}
+
+/* Get stage time in ms at a temperature, g1->lock being held */
+static unsigned long g1_stage_time(struct g1 *g1, int temp)
+{
+	unsigned long stage_time;
+	unsigned int factor;
+
+	factor = g1_temp_factor(g1->temp_curve, g1->temp_curve_len, temp);
+	stage_time = g1_temp_profile[g1->type].stage_time * factor *
+		g1->stage_time_scale;
+	return DIV_ROUND_UP(stage_time, 100 * 100);
+}
+
+/* Read temperature into the cached one, returning the stage time it needs */
+static unsigned long g1_read_temp(struct g1 *g1)
+{
+	unsigned long stage_time;
+	int temp;
+
 	temp = epd_therm_get_temp(g1->therm);
-	if(temp <= -10000)
-		stage_time *= 170;
-	else if(temp <= -5000)
-		stage_time *= 120;
-	else if(temp <= 5000)
-		stage_time *= 80;
-	else if(temp <= 10000)
-		stage_time *= 40;
-	else if(temp <= 15000)
-		stage_time *= 30;
-	else if(temp <= 20000)
-		stage_time *= 20;
-	else if(temp <= 40000)
-		stage_time *= 10;
-	else
-		stage_time *= 7;
 
-	g1->stage_time = DIV_ROUND_UP(stage_time, 10);
+	mutex_lock(&g1->lock);
+	g1->temp = temp;
+	g1->temp_valid = true;
+	stage_time = g1_stage_time(g1, temp);
+	mutex_unlock(&g1->lock);
+	return stage_time;
+}
+
+/*
+ * Set the update stage time from current temperature, only from an update
+ * (hw_lock held), as stages read it.
+ */
+static void g1_compute_stage_time(struct g1 *g1)
+{
+	unsigned long stage_time = g1_read_temp(g1);
+
+	mutex_lock(&g1->lock);
+	g1->stage_time = stage_time;
+	mutex_unlock(&g1->lock);
 }
 
 static int g1_init_pwm(struct g1 *g1)
@@ -262,7 +448,74 @@ static struct spi_cmd const __spi_cmd[] = {
 	SPI_CMD_ENTRY(SPI_CMD_VCOM_LVL, SPI_REGIDX_VCOM, "\xd0\x00"),
 };
 
-static int __spi_send_cmd(struct spi_device *spi, u8 idx, char const *data,
+/*
+ * Record an operation in capture ring, overwriting the oldest record when
+ * full. Records from cap_start to cap_seq are readable.
+ */
+static void g1_capture(struct g1 *g1, u8 type, u8 flags, u32 gpio,
+		void const *data, size_t len)
+{
+	struct g1_capture_rec *rec;
+
+	if(g1->cap == NULL)
+		return;
+
+	spin_lock(&g1->cap_lock);
+	rec = &g1->cap[g1->cap_seq & (g1->cap_nr - 1)];
+	rec->seq = g1->cap_seq++;
+	rec->time_ns = ktime_get_ns();
+	rec->type = type;
+	rec->flags = flags;
+	rec->len = min_t(size_t, len, U16_MAX);
+	rec->gpio = gpio;
+	memset(rec->data, 0, sizeof(rec->data));
+	memcpy(rec->data, data, min(len, sizeof(rec->data)));
+	spin_unlock(&g1->cap_lock);
+}
+
+static void g1_gpio_set(struct g1 *g1, unsigned int gpio, int value)
+{
+	u8 v = value;
+
+	gpio_set_value(gpio, value);
+	g1_capture(g1, G1_CAP_GPIO, 0, gpio, &v, sizeof(v));
+}
+
+static int g1_spi_sync(struct g1 *g1, struct spi_transfer *tx,
+		unsigned int nr)
+{
+	unsigned int i;
+
+	g1->stats.spi_xfers += nr;
+	for(i = 0; i < nr; ++i) {
+		g1->stats.spi_bytes += tx[i].len;
+		g1_capture(g1, G1_CAP_SPI,
+				tx[i].cs_change ? G1_CAP_CS_CHANGE : 0, 0,
+				tx[i].tx_buf, tx[i].len);
+	}
+
+	return spi_sync_transfer(g1->spi, tx, nr);
+}
+
+/* Wait for COG busy line to be released */
+static void g1_wait_busy(struct g1 *g1)
+{
+	ktime_t start;
+	u64 ns;
+
+	if(!gpio_get_value(g1->gpio_busy))
+		return;
+
+	start = ktime_get();
+	while(gpio_get_value(g1->gpio_busy))
+		cpu_relax();
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	g1->stats.busy_ns += ns;
+	trace_g1_busy_wait(g1->id, ns);
+	g1_capture(g1, G1_CAP_BUSY, 0, g1->gpio_busy, &ns, sizeof(ns));
+}
+
+static int __spi_send_cmd(struct g1 *g1, u8 idx, char const *data,
 		size_t len)
 {
 	static char _spi_reg_hdr[] = {SPI_REG_HEADER};
@@ -287,10 +540,10 @@ static int __spi_send_cmd(struct spi_device *spi, u8 idx, char const *data,
 		},
 	};
 
-	return spi_sync_transfer(spi, tx, ARRAY_SIZE(tx));
+	return g1_spi_sync(g1, tx, ARRAY_SIZE(tx));
 }
 
-static int spi_send_cmd(struct spi_device *spi, enum spi_cmd_id cid)
+static int spi_send_cmd(struct g1 *g1, enum spi_cmd_id cid)
 {
 	struct spi_cmd const *c;
 
@@ -299,11 +552,10 @@ static int spi_send_cmd(struct spi_device *spi, enum spi_cmd_id cid)
 
 	c = &__spi_cmd[cid];
 
-	return __spi_send_cmd(spi, c->regid, c->regdata, c->regdata_sz);
+	return __spi_send_cmd(g1, c->regid, c->regdata, c->regdata_sz);
 }
 
-static int spi_send_data(struct spi_device *spi, unsigned int gpio_busy,
-		u8 const *data, size_t len)
+static int spi_send_data(struct g1 *g1, u8 const *data, size_t len)
 {
 	static char _spi_reg_hdr[] = {SPI_REG_HEADER};
 	static char _spi_data_hdr[] = {SPI_DATA_HEADER};
@@ -327,7 +579,7 @@ static int spi_send_data(struct spi_device *spi, unsigned int gpio_busy,
 	size_t i;
 	int ret;
 
-	ret = spi_sync_transfer(spi, tx, ARRAY_SIZE(tx));
+	ret = g1_spi_sync(g1, tx, ARRAY_SIZE(tx));
 	if(ret < 0)
 		return ret;
 
@@ -339,194 +591,300 @@ static int spi_send_data(struct spi_device *spi, unsigned int gpio_busy,
 		if(i + 1 == len)
 			tx[0].cs_change = 0;
 
-		ret = spi_sync_transfer(spi, tx, 1);
+		ret = g1_spi_sync(g1, tx, 1);
 		if(ret < 0)
 			break;
 
-		while(gpio_get_value(gpio_busy))
-			cpu_relax();
+		g1_wait_busy(g1);
 	}
 
 	return ret;
 }
 
-#define G1_ODD_BYTE(dot) (dot)
-#define G1_EVEN_BYTE(dot)						\
-	(((((dot) >> 6) & 0x3) << 0) |					\
-	 ((((dot) >> 4) & 0x3) << 2) |					\
-	 ((((dot) >> 2) & 0x3) << 4) |					\
-	 ((((dot) >> 0) & 0x3) << 6))
+static u8 *g1_stage_data(struct g1 *g1, enum g1_stage stage)
+{
+	if(stage == G1_STAGE_POWEROFF)
+		return g1->poweroff_data;
+	return g1->stages->data[stage];
+}
 
-static int fill_line(struct epd_frame *frame, enum g1_stage stage,
-		size_t line, u8 *data, size_t len)
+static int g1_encode_stage(struct g1 *g1, enum g1_stage stage)
 {
-	u8 *ptr, *end;
-	size_t lbyte, dotnr, scannr, i;
+	struct epd_frame *f;
+	u8 *data = g1_stage_data(g1, stage);
+	size_t nrline;
 	int ret = 0;
-	u8 dot = 0;
 
-	dotnr = frame->nrdot / G1_DOT_PER_BYTE;
-	scannr = frame->nrline / G1_SCAN_PER_BYTE;
-	lbyte = frame->bytes_per_line;
+	if(stage == G1_STAGE_POWEROFF)
+		f = epd_get_cur_fb(g1->epd);
+	else if(stage == G1_STAGE_COMPENSATE || stage == G1_STAGE_WHITE)
+		f = g1->src_old;
+	else
+		f = g1->src_new;
 
-	/* Some length checking */
-	if((len < dotnr + scannr) || (dotnr != 2 * lbyte)) {
-		ret = -EINVAL;
+	ret = g1_encode_frame(f, stage, data, g1->line_sz);
+	if(ret < 0)
+		goto out;
+
+	/* Power off stage ends with a dummy line */
+	nrline = g1_frame_info[g1->type].line;
+	if(stage == G1_STAGE_POWEROFF)
+		ret = g1_fill_line(f, stage, G1_DUMMY_LINE,
+				data + nrline * g1->line_sz, g1->line_sz);
+out:
+	return ret;
+}
+
+/*
+ * Encode a stage of a new frame filled with a constant pattern. Only the first
+ * line is encoded, the others are copies with their scan byte updated.
+ */
+static int g1_encode_fill_stage(struct g1 *g1, enum g1_stage stage)
+{
+	struct epd_frame *f = g1->src_new;
+	u8 *data = g1_stage_data(g1, stage);
+	u8 *line;
+	size_t i, scan;
+	int ret;
+
+	ret = g1_fill_line(f, stage, 0, data, g1->line_sz);
+	if(ret < 0)
 		goto out;
+
+	/* Scan bytes follow odd dots bytes */
+	scan = f->bytes_per_line;
+	for(i = 1; i < f->nrline; ++i) {
+		line = data + i * g1->line_sz;
+		memcpy(line, data, g1->line_sz);
+		line[scan] = G1_SCAN_OFF;
+		line[scan + i / G1_SCAN_PER_BYTE] = 0xc0 >> (G1_SCAN_NRBIT *
+				(i % G1_SCAN_PER_BYTE));
 	}
+out:
+	return ret;
+}
 
-	ptr = data;
-	end = data + len;
+static size_t g1_frame_sz(struct g1 *g1)
+{
+	struct epd_frame_size const *fsz = &g1_frame_info[g1->type];
 
-	/* odd dots (263, ..., 3, 1) */
-	for(i = lbyte; i > 0; --i, ++ptr) {
-		if(line != G1_DUMMY_LINE)
-			dot = frame->data[line * lbyte + i - 1] & 0xaa;
-		switch(stage) {
-		case G1_STAGE_COMPENSATE:
-			*ptr = G1_ODD_BYTE(~(dot >> 1));
-			break;
-		case G1_STAGE_WHITE:
-			*ptr = G1_ODD_BYTE(dot ^ 0xaa);
-			break;
-		case G1_STAGE_INVERSE:
-			*ptr = G1_ODD_BYTE(~dot);
-			break;
-		case G1_STAGE_NORMAL:
-			*ptr = G1_ODD_BYTE((dot >> 1) | 0xaa);
-			break;
-		case G1_STAGE_POWEROFF:
-			*ptr = 0x55;
-			break;
-		}
+	return fsz->line * DIV_ROUND_UP(fsz->col, 8);
+}
+
+static size_t g1_stages_sz(struct g1 *g1)
+{
+	return sizeof(struct g1_stages) + 2 * g1_frame_sz(g1) +
+		G1_STAGE_POWEROFF * g1_frame_info[g1->type].line * g1->line_sz;
+}
+
+static void g1_stages_free(struct g1_stages *st)
+{
+	size_t i;
+
+	if(st == NULL)
+		return;
+
+	for(i = 0; i < ARRAY_SIZE(st->data); ++i)
+		kfree(st->data[i]);
+	kfree(st->fold);
+	kfree(st->fnew);
+	kfree(st);
+}
+
+static struct g1_stages *g1_stages_alloc(struct g1 *g1)
+{
+	struct g1_stages *st;
+	size_t i;
+
+	st = kzalloc(sizeof(*st), GFP_KERNEL);
+	if(st == NULL)
+		goto fail;
+
+	INIT_LIST_HEAD(&st->next);
+	st->fold = kmalloc(g1_frame_sz(g1), GFP_KERNEL);
+	st->fnew = kmalloc(g1_frame_sz(g1), GFP_KERNEL);
+	if(st->fold == NULL || st->fnew == NULL)
+		goto fail;
+
+	for(i = 0; i < ARRAY_SIZE(st->data); ++i) {
+		st->data[i] = kmalloc(g1_frame_info[g1->type].line *
+				g1->line_sz, GFP_KERNEL);
+		if(st->data[i] == NULL)
+			goto fail;
 	}
 
-	/* Scan line */
-	for(i = 0; i < scannr; ++i, ++ptr) {
-		if(i == line / G1_SCAN_PER_BYTE) {
-			*ptr = 0xc0 >> (G1_SCAN_NRBIT *
-					(line % G1_SCAN_PER_BYTE));
-		} else {
-			*ptr = G1_SCAN_OFF;
+	return st;
+
+fail:
+	g1_stages_free(st);
+	return NULL;
+}
+
+static u64 g1_stages_key(struct g1 *g1, struct epd_frame const *fold,
+		struct epd_frame const *fnew)
+{
+	u64 key = G1_HASH_INIT;
+	u8 type = g1->type;
+
+	key = g1_hash(key, &type, sizeof(type));
+	key = g1_hash(key, (u8 const *)&fold->xform, sizeof(fold->xform));
+	key = g1_hash(key, (u8 const *)&fnew->xform, sizeof(fnew->xform));
+	key = g1_hash(key, fold->data, g1_frame_sz(g1));
+	key = g1_hash(key, fnew->data, g1_frame_sz(g1));
+
+	return key;
+}
+
+static struct epd_frame *g1_panel_frame(struct epd_frame *f,
+		struct epd_frame *tmp)
+{
+	if(!(f->xform & EPD_XFORM_TRANSPOSE))
+		return f;
+
+	epd_frame_transpose(f, tmp);
+	return tmp;
+}
+
+/*
+ * Get a cache entry for an update, becoming the current one. A new cache entry
+ * is allocated if memory budget allows it, otherwise least recently used one is
+ * recycled.
+ */
+static struct g1_stages *g1_stages_new(struct g1 *g1, u64 key,
+		struct epd_frame const *fold, struct epd_frame const *fnew)
+{
+	struct g1_stages *st = NULL;
+	size_t fsz = g1_frame_sz(g1);
+
+	if((g1->stage_cache_nr + 1) * g1_stages_sz(g1) <=
+			(size_t)stage_cache_kb * 1024) {
+		st = g1_stages_alloc(g1);
+		if(st != NULL) {
+			list_add(&st->next, &g1->stage_cache);
+			++g1->stage_cache_nr;
 		}
 	}
 
-	/* even dots (0, 2, ..., 262) */
-	for(i = 0; i < lbyte; ++i, ++ptr) {
-		if(line != G1_DUMMY_LINE)
-			dot = frame->data[line * lbyte + i] & 0x55;
-		switch(stage) {
-		case G1_STAGE_COMPENSATE:
-			*ptr = G1_EVEN_BYTE(~dot);
-			break;
-		case G1_STAGE_WHITE:
-			*ptr = G1_EVEN_BYTE((dot ^ 0x55) << 1);
-			break;
-		case G1_STAGE_INVERSE:
-			*ptr = G1_EVEN_BYTE((dot + 0x55) ^ 0xaa);
-			break;
-		case G1_STAGE_NORMAL:
-			*ptr = G1_EVEN_BYTE(dot | 0xaa);
-			break;
-		case G1_STAGE_POWEROFF:
-			*ptr = 0x55;
-			break;
+	if(st == NULL) {
+		st = list_last_entry(&g1->stage_cache, struct g1_stages, next);
+		list_move(&st->next, &g1->stage_cache);
+	}
+
+	/* Entry becomes valid once all its stages are filled */
+	st->valid = false;
+	st->key = key;
+	st->fold_xform = fold->xform;
+	st->fnew_xform = fnew->xform;
+	memcpy(st->fold, fold->data, fsz);
+	memcpy(st->fnew, fnew->data, fsz);
+	g1->stages = st;
+
+	return st;
+}
+
+/*
+ * Find encoded stages for current update in cache, a new entry is used on a
+ * miss. Returns true on a hit.
+ */
+static bool g1_stages_lookup(struct g1 *g1)
+{
+	struct epd_frame *fold = epd_get_cur_fb(g1->epd);
+	struct epd_frame *fnew = epd_get_alt_fb(g1->epd);
+	struct g1_stages *st;
+	size_t fsz = g1_frame_sz(g1);
+	u64 key;
+
+	key = g1_stages_key(g1, fold, fnew);
+	list_for_each_entry(st, &g1->stage_cache, next) {
+		if(st->valid && st->key == key &&
+				st->fold_xform == fold->xform &&
+				st->fnew_xform == fnew->xform &&
+				memcmp(st->fold, fold->data, fsz) == 0 &&
+				memcmp(st->fnew, fnew->data, fsz) == 0) {
+			list_move(&st->next, &g1->stage_cache);
+			g1->stages = st;
+			++g1->stage_cache_hits;
+			return true;
 		}
 	}
 
-	/* filler */
-	while(ptr < end)
-		*ptr++ = 0;
+	++g1->stage_cache_misses;
+	g1_stages_new(g1, key, fold, fnew);
 
-out:
-	return ret;
+	/* Stages are encoded from frames in panel geometry */
+	g1->src_old = g1_panel_frame(fold, g1->tframe[0]);
+	g1->src_new = g1_panel_frame(fnew, g1->tframe[1]);
+
+	return false;
 }
 
-static int g1_draw_line(struct g1 *g1, enum g1_stage stage, size_t line)
+/* Draw a stage line, pass being the stage pass it belongs to */
+static int g1_draw_line(struct g1 *g1, enum g1_stage stage, unsigned int pass,
+		unsigned int line)
 {
-	struct epd_frame_size const *fsz;
-	struct epd_frame *f;
-	u8 *data = NULL;
-	size_t dotnr, scannr;
-	int ret, filler = 0;
+	u8 const *data = g1_stage_data(g1, stage) + line * g1->line_sz;
+	int ret = 0;
 
+	trace_g1_line(g1->id, stage, pass, line, g1->line_sz);
 	switch(g1->type) {
 	case G1_TYPE_1_44:
-		filler = 0;
-		ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_1_44);
-		if(ret < 0)
-			goto out;
+		ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_1_44);
 		break;
 	case G1_TYPE_2:
-		filler = 1;
-		ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_2);
-		if(ret < 0)
-			goto out;
+		ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_2);
 		break;
 	case G1_TYPE_2_7:
-		filler = 1;
-		ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_2_7);
-		if(ret < 0)
-			goto out;
+		ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_2_7);
 		break;
 	}
-
-	if(stage == G1_STAGE_COMPENSATE || stage == G1_STAGE_WHITE)
-		f = epd_get_cur_fb(g1->epd);
-	else
-		f = epd_get_alt_fb(g1->epd);
-
-	fsz = &g1_frame_info[g1->type];
-	dotnr = fsz->col / G1_DOT_PER_BYTE;
-	scannr = fsz->line / G1_SCAN_PER_BYTE;
-
-	data = kmalloc(dotnr + scannr + filler, GFP_KERNEL);
-	if(data == NULL) {
-		ret = -ENOMEM;
-		goto out;
-	}
-
-	ret = fill_line(f, stage, line, data, dotnr + scannr + filler);
-	if(ret)
+	if(ret < 0)
 		goto out;
 
-	ret = spi_send_data(g1->spi, g1->gpio_busy, data,
-			dotnr + scannr + filler);
+	ret = spi_send_data(g1, data, g1->line_sz);
 	if(ret)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_OUTPUT_ENABLE);
+	ret = spi_send_cmd(g1, SPI_CMD_OUTPUT_ENABLE);
 
 out:
-	if(data)
-		kfree(data);
-
 	return ret;
 }
 
+/* Account a stage drawn since start, pass_time being its first pass time */
+static void g1_stage_done(struct g1 *g1, enum g1_stage stage, ktime_t start,
+		unsigned int passes, u64 pass_time)
+{
+	g1->stats.stage_ns[stage] += ktime_to_ns(ktime_sub(ktime_get(), start));
+	g1->stats.passes[stage] += passes;
+	trace_g1_stage_end(g1->id, stage, passes, pass_time);
+}
+
 static int g1_poweroff_stage(struct g1 *g1)
 {
-	size_t i;
+	ktime_t start = ktime_get();
+	unsigned int i;
 	int ret = 0;
 
-	for(i = 0; i < g1_frame_info[g1->type].line; ++i) {
-		ret = g1_draw_line(g1, G1_STAGE_POWEROFF, i);
+	trace_g1_stage_start(g1->id, G1_STAGE_POWEROFF, 0);
+	/* All frame lines plus the dummy one */
+	for(i = 0; i <= g1_frame_info[g1->type].line; ++i) {
+		ret = g1_draw_line(g1, G1_STAGE_POWEROFF, 0, i);
 		if(ret < 0)
 			goto out;
 	}
-
-	ret = g1_draw_line(g1, G1_STAGE_POWEROFF, G1_DUMMY_LINE);
+	g1_stage_done(g1, G1_STAGE_POWEROFF, start, 1,
+			ktime_to_ns(ktime_sub(ktime_get(), start)));
 out:
 	return ret;
 }
 
-static int g1_draw_stage(struct g1 *g1, enum g1_stage stage)
+static int g1_draw_stage(struct g1 *g1, enum g1_stage stage, unsigned int pass)
 {
-	size_t i;
+	unsigned int i;
 	int ret = 0;
 
 	for(i = 0; i < g1_frame_info[g1->type].line; ++i) {
-		ret = g1_draw_line(g1, stage, i);
+		ret = g1_draw_line(g1, stage, pass, i);
 		if(ret < 0)
 			goto out;
 	}
@@ -534,44 +892,147 @@ out:
 	return ret;
 }
 
+/*
+ * Draw a stage for stage_time. The first pass is timed and the number of passes
+ * is computed from it, rounded up, so that a stage is always drawn the same
+ * number of times and lasts at least stage_time, as the panel needs.
+ */
 static int g1_repeat_stage(struct g1 *g1, enum g1_stage stage)
 {
-	unsigned long timeout;
+	ktime_t start;
+	u64 pass_time;
+	unsigned int i, passes;
 	int ret;
 
-	timeout = jiffies + msecs_to_jiffies(g1->stage_time);
-	do {
-		ret = g1_draw_stage(g1, stage);
+	trace_g1_stage_start(g1->id, stage, g1->stage_time);
+	start = ktime_get();
+	ret = g1_draw_stage(g1, stage, 0);
+	if(ret < 0)
+		goto out;
+	pass_time = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if(pass_time == 0)
+		pass_time = 1;
+
+	passes = DIV64_U64_ROUND_UP((u64)g1->stage_time * NSEC_PER_MSEC,
+			pass_time);
+	if(passes == 0)
+		passes = 1;
+
+	g1->pass_time = pass_time;
+	g1->passes = passes;
+	DBG("Stage %d: %u passes of %llu ns\n", stage, passes,
+			(unsigned long long)pass_time);
+
+	for(i = 1; i < passes; ++i) {
+		ret = g1_draw_stage(g1, stage, i);
+		if(ret < 0)
+			goto out;
+	}
+	g1_stage_done(g1, stage, start, passes, pass_time);
+
+out:
+	return ret;
+}
+
+/*
+ * Run the next pending frame preparation step, that is reading temperature,
+ * looking for already encoded stages then encoding each drawing stage.
+ */
+static int g1_prepare_step(struct g1 *g1)
+{
+	enum g1_stage stage;
+	int ret = 0;
+
+	if(g1->prep == G1_PREP_THERM) {
+		g1_compute_stage_time(g1);
+		DBG("Stage time : %lu\n", g1->stage_time);
+	} else if(g1->prep == G1_PREP_LOOKUP) {
+		/* Pre-encoded stages are private to their update, never cached */
+		if(g1->encoded != NULL) {
+			g1->stages = g1->encoded;
+			g1->prep = G1_PREP_DONE;
+			return 0;
+		}
+		if(g1_stages_lookup(g1)) {
+			DBG("Encoded stages found in cache\n");
+			g1->prep = G1_PREP_DONE;
+			return 0;
+		}
+	} else {
+		stage = g1->prep - G1_PREP_STAGE(0);
+		if(g1->fill >= 0 && (stage == G1_STAGE_INVERSE ||
+					stage == G1_STAGE_NORMAL))
+			ret = g1_encode_fill_stage(g1, stage);
+		else
+			ret = g1_encode_stage(g1, stage);
+		if(ret < 0)
+			goto out;
+		if(stage == G1_STAGE_NORMAL)
+			g1->stages->valid = true;
+	}
+
+	++g1->prep;
+out:
+	return ret;
+}
+
+/*
+ * Wait for a power sequence delay to elapse. Pending frame preparation steps
+ * are run meanwhile so that the first stage can be sent as soon as the panel
+ * is ready.
+ */
+static int g1_settle(struct g1 *g1, unsigned int ms)
+{
+	ktime_t end = ktime_add_ms(ktime_get(), ms);
+	int ret = 0;
+
+	while(g1->prep < G1_PREP_DONE && ktime_before(ktime_get(), end)) {
+		ret = g1_prepare_step(g1);
 		if(ret < 0)
 			goto out;
-	} while(time_before(jiffies, timeout));
+	}
 
+	while(ktime_before(ktime_get(), end))
+		cpu_relax();
 out:
 	return ret;
 }
 
+/* Settle delays of g1_power_on() and g1_init_display() */
+#define G1_POWER_ON_MS 120
+/* Delays of g1_power_off(), poweroff stage aside */
+#define G1_POWER_OFF_MS 625
+
 static int g1_power_on(struct g1 *g1)
 {
 	int ret;
 
 	/* XXX Maybe reset all gpio here */
 
+	trace_g1_power(g1->id, G1_TRACE_POWER_ON);
 	ret = pwm_enable(g1->pwm);
 	if(ret < 0) {
 		goto out;
 	}
-	gpio_set_value(g1->gpio_panel_on, 1);
-	mdelay(10);
+	g1_gpio_set(g1, g1->gpio_panel_on, 1);
+	ret = g1_settle(g1, 10);
+	if(ret < 0)
+		goto out;
 
 	/* TODO /CS is already set to 1 */
 
-	gpio_set_value(g1->gpio_border, 1);
-	gpio_set_value(g1->gpio_reset, 1);
-	mdelay(5);
-	gpio_set_value(g1->gpio_reset, 0);
-	mdelay(5);
-	gpio_set_value(g1->gpio_reset, 1);
-	mdelay(5);
+	trace_g1_power(g1->id, G1_TRACE_RESET);
+	g1_gpio_set(g1, g1->gpio_border, 1);
+	g1_gpio_set(g1, g1->gpio_reset, 1);
+	ret = g1_settle(g1, 5);
+	if(ret < 0)
+		goto out;
+	g1_gpio_set(g1, g1->gpio_reset, 0);
+	ret = g1_settle(g1, 5);
+	if(ret < 0)
+		goto out;
+	g1_gpio_set(g1, g1->gpio_reset, 1);
+	ret = g1_settle(g1, 5);
 out:
 	return ret;
 }
@@ -580,64 +1041,68 @@ static int g1_power_off(struct g1 *g1)
 {
 	int ret;
 
+	trace_g1_power(g1->id, G1_TRACE_POWER_OFF);
 	ret = g1_poweroff_stage(g1);
 	if(ret < 0)
 		goto out;
 
+	trace_g1_power(g1->id, G1_TRACE_BORDER);
 	mdelay(25);
-	gpio_set_value(g1->gpio_border, 0);
+	g1_gpio_set(g1, g1->gpio_border, 0);
 	mdelay(250);
-	gpio_set_value(g1->gpio_border, 1);
+	g1_gpio_set(g1, g1->gpio_border, 1);
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_LATCH_ON);
+	trace_g1_power(g1->id, G1_TRACE_DISCHARGE);
+	ret = spi_send_cmd(g1, SPI_CMD_LATCH_ON);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_OUTPUT_OFF);
+	ret = spi_send_cmd(g1, SPI_CMD_OUTPUT_OFF);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_CHARGEPUMP_VCOM_OFF);
+	ret = spi_send_cmd(g1, SPI_CMD_CHARGEPUMP_VCOM_OFF);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_CHARGEPUMP_VNEG_OFF);
+	ret = spi_send_cmd(g1, SPI_CMD_CHARGEPUMP_VNEG_OFF);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_DISCHARGE_1);
+	ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_DISCHARGE_1);
 	if(ret < 0)
 		goto out;
 	mdelay(120);
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_CHARGEPUMP_VPOS_OFF);
+	ret = spi_send_cmd(g1, SPI_CMD_CHARGEPUMP_VPOS_OFF);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_OSC_OFF);
+	ret = spi_send_cmd(g1, SPI_CMD_OSC_OFF);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_DISCHARGE_2);
+	ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_DISCHARGE_2);
 	if(ret < 0)
 		goto out;
 	mdelay(40);
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_DISCHARGE_3);
+	ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_DISCHARGE_3);
 	if(ret < 0)
 		goto out;
 	mdelay(40);
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_DISCHARGE_0);
+	ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_DISCHARGE_0);
 	if(ret < 0)
 		goto out;
 
-	gpio_set_value(g1->gpio_border, 0);
-	gpio_set_value(g1->gpio_reset, 0);
-	gpio_set_value(g1->gpio_panel_on, 0);
-	gpio_set_value(g1->gpio_discharge, 1);
+	g1_gpio_set(g1, g1->gpio_border, 0);
+	g1_gpio_set(g1, g1->gpio_reset, 0);
+	g1_gpio_set(g1, g1->gpio_panel_on, 0);
+	g1_gpio_set(g1, g1->gpio_discharge, 1);
 	mdelay(150);
-	gpio_set_value(g1->gpio_discharge, 0);
+	g1_gpio_set(g1, g1->gpio_discharge, 0);
+	trace_g1_power(g1->id, G1_TRACE_OFF);
 out:
 	return ret;
 }
@@ -646,135 +1111,387 @@ static int g1_init_display(struct g1 *g1)
 {
 	int ret = 0;
 
-	while(gpio_get_value(g1->gpio_busy))
-		cpu_relax();
+	g1_wait_busy(g1);
 
 	switch(g1->type) {
 	case G1_TYPE_1_44:
-		ret = spi_send_cmd(g1->spi, SPI_CMD_CHANSEL_1_44);
+		ret = spi_send_cmd(g1, SPI_CMD_CHANSEL_1_44);
 		break;
 	case G1_TYPE_2:
-		ret = spi_send_cmd(g1->spi, SPI_CMD_CHANSEL_2);
+		ret = spi_send_cmd(g1, SPI_CMD_CHANSEL_2);
 		break;
 	case G1_TYPE_2_7:
-		ret = spi_send_cmd(g1->spi, SPI_CMD_CHANSEL_2_7);
+		ret = spi_send_cmd(g1, SPI_CMD_CHANSEL_2_7);
 		break;
 	}
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_DCFREQ);
+	ret = spi_send_cmd(g1, SPI_CMD_DCFREQ);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_OSC_ON);
+	ret = spi_send_cmd(g1, SPI_CMD_OSC_ON);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_ADC_DISABLE);
+	ret = spi_send_cmd(g1, SPI_CMD_ADC_DISABLE);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_VCOM_LVL);
+	ret = spi_send_cmd(g1, SPI_CMD_VCOM_LVL);
 	if(ret < 0)
 		goto out;
 
 	switch(g1->type) {
 	case G1_TYPE_1_44:
-		ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_1_44);
+		ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_1_44);
 		break;
 	case G1_TYPE_2:
-		ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_2);
+		ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_2);
 		break;
 	case G1_TYPE_2_7:
-		ret = spi_send_cmd(g1->spi, SPI_CMD_GATE_SRC_LVL_2_7);
+		ret = spi_send_cmd(g1, SPI_CMD_GATE_SRC_LVL_2_7);
 		break;
 	}
 	if(ret < 0)
 		goto out;
-	mdelay(5);
+	ret = g1_settle(g1, 5);
+	if(ret < 0)
+		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_LATCH_ON);
+	ret = spi_send_cmd(g1, SPI_CMD_LATCH_ON);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_LATCH_OFF);
+	ret = spi_send_cmd(g1, SPI_CMD_LATCH_OFF);
 	if(ret < 0)
 		goto out;
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_CHARGEPUMP_VPOS_ON);
+	ret = spi_send_cmd(g1, SPI_CMD_CHARGEPUMP_VPOS_ON);
+	if(ret < 0)
+		goto out;
+	ret = g1_settle(g1, 30);
 	if(ret < 0)
 		goto out;
-	mdelay(30);
 
 	pwm_disable(g1->pwm);
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_CHARGEPUMP_VNEG_ON);
+	ret = spi_send_cmd(g1, SPI_CMD_CHARGEPUMP_VNEG_ON);
+	if(ret < 0)
+		goto out;
+	ret = g1_settle(g1, 30);
 	if(ret < 0)
 		goto out;
-	mdelay(30);
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_CHARGEPUMP_VCOM_ON);
+	ret = spi_send_cmd(g1, SPI_CMD_CHARGEPUMP_VCOM_ON);
+	if(ret < 0)
+		goto out;
+	ret = g1_settle(g1, 30);
 	if(ret < 0)
 		goto out;
-	mdelay(30);
 
-	ret = spi_send_cmd(g1->spi, SPI_CMD_OUTPUT_DISABLE);
+	ret = spi_send_cmd(g1, SPI_CMD_OUTPUT_DISABLE);
 	if(ret < 0)
 		goto out;
 out:
 	return ret;
 }
 
-static int g1_draw_frame(struct epd_driver *drv)
+/*
+ * Run the complete power off sequence if panel is still powered. Should be
+ * called with hw_lock held.
+ */
+static int g1_shutdown(struct g1 *g1)
 {
-	struct g1 *g1 = g1_from_epd_drv(drv);
-	int ret;
+	int ret = 0;
 
-	DBG("Power on display\n");
-	ret = g1_power_on(g1);
-	if(ret < 0)
+	if(!g1->powered)
 		goto out;
 
-	DBG("Init display\n");
-	ret = g1_init_display(g1);
-	if(ret < 0)
-		goto out;
+	DBG("Power off display\n");
+	ret = g1_power_off(g1);
+	g1->powered = false;
+out:
+	return ret;
+}
 
-	g1_compute_stage_time(g1);
-	DBG("Stage time : %lu\n", g1->stage_time);
+static void g1_poweroff_work(struct work_struct *work)
+{
+	struct g1 *g1 = container_of(to_delayed_work(work), struct g1,
+			poweroff_work);
+
+	mutex_lock(&g1->hw_lock);
+	/* An update may have re-armed the idle timeout meanwhile */
+	if(!delayed_work_pending(&g1->poweroff_work))
+		g1_shutdown(g1);
+	mutex_unlock(&g1->hw_lock);
+}
 
-	DBG("Draw compensate stage\n");
+/*
+ * Cancel pending deferred power off and shut panel down now
+ */
+static int g1_sync_shutdown(struct g1 *g1)
+{
+	int ret;
+
+	cancel_delayed_work_sync(&g1->poweroff_work);
+	mutex_lock(&g1->hw_lock);
+	ret = g1_shutdown(g1);
+	mutex_unlock(&g1->hw_lock);
+
+	return ret;
+}
+
+/*
+ * Stage duration for stage_time, with the same pass count as g1_repeat_stage()
+ * from the last measured pass time, or stage_time if none has been measured
+ */
+static u64 g1_stage_ns(struct g1 *g1, unsigned long stage_time)
+{
+	u64 stage = (u64)stage_time * NSEC_PER_MSEC;
+	u64 pass = READ_ONCE(g1->pass_time);
+
+	if(pass != 0)
+		stage = max_t(u64, DIV64_U64_ROUND_UP(stage, pass), 1) * pass;
+	return stage;
+}
+
+/*
+ * Draw an update. With a non zero deadline, update is started g1_draw_lead()
+ * before it, so that panel is powered on and frame is prepared just in time
+ * for the first stages, then normal stage is drawn at deadline, its start time
+ * being set in shown.
+ */
+static int g1_update(struct g1 *g1, int fill, ktime_t deadline,
+		ktime_t *shown)
+{
+	unsigned int timeout;
+	int ret;
+
+	mutex_lock(&g1->hw_lock);
+	cancel_delayed_work(&g1->poweroff_work);
+
+	/* Negative fill means new frame is not known to be a constant one */
+	g1->fill = fill;
+
+	/* Temperature and encoding are done during power on delays */
+	g1->prep = G1_PREP_THERM;
+
+	if(!g1->powered) {
+		DBG("Power on display\n");
+		ret = g1_power_on(g1);
+		if(ret < 0)
+			goto err;
+
+		DBG("Init display\n");
+		trace_g1_power(g1->id, G1_TRACE_INIT);
+		ret = g1_init_display(g1);
+		if(ret < 0)
+			goto err;
+		trace_g1_power(g1->id, G1_TRACE_READY);
+		g1->powered = true;
+	}
+
+	while(g1->prep < G1_PREP_DONE) {
+		ret = g1_prepare_step(g1);
+		if(ret < 0)
+			goto err;
+	}
+
+	/* Compensate, white and inverse stages end at deadline */
+	if(deadline != 0) {
+		ret = epd_sleep_until(ktime_sub(deadline,
+					3 * g1_stage_ns(g1, g1->stage_time)));
+		if(ret < 0)
+			goto err;
+	}
+
+	DBG("Draw compensate stage\n");
 	ret = g1_repeat_stage(g1, G1_STAGE_COMPENSATE);
 	if(ret < 0)
-		goto out;
+		goto err;
 
 	DBG("Draw white stage\n");
 	ret = g1_repeat_stage(g1, G1_STAGE_WHITE);
 	if(ret < 0)
-		goto out;
+		goto err;
 
 	DBG("Draw inverse stage\n");
 	ret = g1_repeat_stage(g1, G1_STAGE_INVERSE);
 	if(ret < 0)
-		goto out;
+		goto err;
+
+	if(deadline != 0) {
+		ret = epd_sleep_until(deadline);
+		if(ret < 0)
+			goto err;
+		*shown = ktime_get();
+	}
 
 	DBG("Draw normal stage\n");
 	ret = g1_repeat_stage(g1, G1_STAGE_NORMAL);
 	if(ret < 0)
-		goto out;
+		goto err;
 
-	DBG("Power off display\n");
-	ret = g1_power_off(g1);
+	/* Keep panel powered for a while if another update comes soon */
+	timeout = READ_ONCE(g1->hot_timeout);
+	if(timeout != 0)
+		schedule_delayed_work(&g1->poweroff_work,
+				msecs_to_jiffies(timeout));
+	else
+		ret = g1_shutdown(g1);
 out:
+	mutex_unlock(&g1->hw_lock);
+	return ret;
+err:
+	/* Do not leave panel energized, next update powers it on again */
+	DBG("Power off display after failure\n");
+	g1_power_off(g1);
+	g1->powered = false;
+	goto out;
+}
+
+static int g1_draw_frame(struct epd_driver *drv)
+{
+	struct g1 *g1 = g1_from_epd_drv(drv);
+
+	return g1_update(g1, -1, 0, NULL);
+}
+
+static int g1_draw_frame_at(struct epd_driver *drv, ktime_t deadline,
+		ktime_t *shown)
+{
+	struct g1 *g1 = g1_from_epd_drv(drv);
+
+	return g1_update(g1, -1, deadline, shown);
+}
+
+/*
+ * Deadline update starts with power on and frame preparation, then compensate,
+ * white and inverse stages before frame shows, estimated from a fresh
+ * temperature read. The update stage time is left to the update to set.
+ */
+static u64 g1_draw_lead(struct epd_driver *drv)
+{
+	struct g1 *g1 = g1_from_epd_drv(drv);
+
+	return (u64)G1_DEADLINE_LEAD_MS * NSEC_PER_MSEC +
+		3 * g1_stage_ns(g1, g1_read_temp(g1));
+}
+
+/*
+ * Predict an update duration from the cached temperature and the last measured
+ * stage pass time, a stage being drawn for stage time if no pass has been
+ * measured yet.
+ */
+static int g1_predict(struct epd_driver *drv, int powered, u64 *duration,
+		u64 *shown)
+{
+	struct g1 *g1 = g1_from_epd_drv(drv);
+	size_t nrline = g1_frame_info[g1->type].line;
+	u64 stage, pass, t = 0;
+	unsigned long stage_time;
+
+	if(!READ_ONCE(g1->temp_valid))
+		g1_read_temp(g1);
+
+	mutex_lock(&g1->lock);
+	stage_time = g1_stage_time(g1, g1->temp);
+	mutex_unlock(&g1->lock);
+	pass = READ_ONCE(g1->pass_time);
+	stage = g1_stage_ns(g1, stage_time);
+
+	if(powered < 0)
+		powered = READ_ONCE(g1->powered);
+	if(!powered)
+		t += (u64)G1_POWER_ON_MS * NSEC_PER_MSEC;
+
+	*shown = t + 3 * stage;
+	t = *shown + stage;
+
+	if(READ_ONCE(g1->hot_timeout) == 0)
+		t += (u64)G1_POWER_OFF_MS * NSEC_PER_MSEC +
+			div64_u64(pass * (nrline + 1), nrline);
+
+	*duration = t;
+	return 0;
+}
+
+static int g1_draw_fill(struct epd_driver *drv, u8 pattern)
+{
+	struct g1 *g1 = g1_from_epd_drv(drv);
+
+	return g1_update(g1, pattern, 0, NULL);
+}
+
+/*
+ * Draw a pre-encoded update. Its stages are drawn from a private copy, never
+ * from stage cache where a later update of the same frames could find them.
+ */
+static int g1_draw_encoded(struct epd_driver *drv, void const *buf,
+		size_t len)
+{
+	struct g1 *g1 = g1_from_epd_drv(drv);
+	struct epd_frame *fold = epd_get_cur_fb(g1->epd);
+	struct epd_frame *fnew = epd_get_alt_fb(g1->epd);
+	struct g1_img_hdr const *hdr = buf;
+	struct g1_stages *st;
+	u8 const *frame, *stages;
+	size_t fsz = g1_frame_sz(g1), i;
+	size_t ssz = g1_frame_info[g1->type].line * g1->line_sz;
+	int ret;
+
+	ret = g1_img_check(g1->type, buf, len);
+	if(ret < 0)
+		return ret;
+
+	/* Update has been encoded for untransformed frames */
+	if(fold->xform != 0 || fnew->xform != 0)
+		return -EINVAL;
+
+	if(le64_to_cpu(hdr->old_hash) != g1_hash(G1_HASH_INIT, fold->data, fsz))
+		return -ESTALE;
+
+	st = g1_stages_alloc(g1);
+	if(st == NULL)
+		return -ENOMEM;
+
+	frame = (u8 const *)(hdr + 1);
+	stages = frame + fsz;
+	memcpy(fnew->data, frame, fsz);
+	for(i = 0; i < G1_STAGE_POWEROFF; ++i)
+		memcpy(st->data[i], stages + i * ssz, ssz);
+	st->valid = true;
+
+	mutex_lock(&g1->hw_lock);
+	g1->encoded = st;
+	mutex_unlock(&g1->hw_lock);
+
+	ret = g1_update(g1, -1, 0, NULL);
+
+	mutex_lock(&g1->hw_lock);
+	g1->encoded = NULL;
+	if(g1->stages == st)
+		g1->stages = NULL;
+	mutex_unlock(&g1->hw_lock);
+	g1_stages_free(st);
+
 	return ret;
 }
 
 static struct epd_driver const g1_drv = {
 	.name = "g1-epd",
 	.desc = DRIVER_DESC,
+	.xforms = EPD_XFORM_TRANSPOSE | EPD_XFORM_VFLIP | EPD_XFORM_HFLIP |
+		EPD_XFORM_INVERT | EPD_XFORM_NATIVE,
 	.ops = {
 		.draw_frame = g1_draw_frame,
+		.draw_frame_at = g1_draw_frame_at,
+		.draw_fill = g1_draw_fill,
+		.draw_encoded = g1_draw_encoded,
+		.predict = g1_predict,
+		.draw_lead = g1_draw_lead,
 	},
 };
 
@@ -840,16 +1557,75 @@ out:
 	return ret;
 }
 
+static void g1_cleanup_stages(struct g1 *g1)
+{
+	struct g1_stages *st, *tmp;
+
+	list_for_each_entry_safe(st, tmp, &g1->stage_cache, next) {
+		list_del(&st->next);
+		g1_stages_free(st);
+	}
+	g1->stage_cache_nr = 0;
+	g1->stages = NULL;
+
+	kfree(g1->poweroff_data);
+	g1->poweroff_data = NULL;
+	kfree(g1->tframe[0]);
+	kfree(g1->tframe[1]);
+	g1->tframe[0] = g1->tframe[1] = NULL;
+}
+
+static int g1_setup_stages(struct g1 *g1)
+{
+	struct epd_frame_size const *fsz = &g1_frame_info[g1->type];
+	struct g1_stages *st;
+
+	g1->line_sz = g1_line_sz(g1->type);
+
+	/* Power off stage has a trailing dummy line */
+	g1->poweroff_data = kmalloc((fsz->line + 1) * g1->line_sz, GFP_KERNEL);
+	if(g1->poweroff_data == NULL)
+		goto fail;
+
+	/*
+	 * Transposed frames are turned back into panel geometry into these,
+	 * panel line number being a multiple of 8 they have the same size.
+	 */
+	g1->tframe[0] = kmalloc(sizeof(struct epd_frame) + g1_frame_sz(g1),
+			GFP_KERNEL);
+	g1->tframe[1] = kmalloc(sizeof(struct epd_frame) + g1_frame_sz(g1),
+			GFP_KERNEL);
+	if(g1->tframe[0] == NULL || g1->tframe[1] == NULL)
+		goto fail;
+
+	/* Always keep at least one entry to encode updates into */
+	st = g1_stages_alloc(g1);
+	if(st == NULL)
+		goto fail;
+	list_add(&st->next, &g1->stage_cache);
+	g1->stage_cache_nr = 1;
+
+	return 0;
+
+fail:
+	g1_cleanup_stages(g1);
+	return -ENOMEM;
+}
+
 static void g1_destroy(struct g1 *g1)
 {
 	if(g1 == NULL)
 		return;
+	/* Unregister screen first so that no update re-arms power off */
 	if(g1->epd)
 		epd_put(g1->epd);
+	g1_sync_shutdown(g1);
 	if(g1->pwm)
 		g1_cleanup_pwm(g1);
 	if(g1->therm)
 		g1_cleanup_thermal(g1);
+	g1_cleanup_stages(g1);
+	vfree(g1->cap);
 	kfree(g1);
 }
 
@@ -859,6 +1635,7 @@ static struct g1 *g1_create(struct spi_device *spi,
 	struct g1 *g1 = NULL;
 	struct epd *epd = NULL;
 	struct epd_frame_size const *framesz;
+	size_t cap_sz;
 	int err;
 
 	/**
@@ -869,6 +1646,11 @@ static struct g1 *g1_create(struct spi_device *spi,
 		err = -ENOMEM;
 		goto fail;
 	}
+	mutex_init(&g1->lock);
+	mutex_init(&g1->hw_lock);
+	spin_lock_init(&g1->cap_lock);
+	INIT_LIST_HEAD(&g1->stage_cache);
+	INIT_DELAYED_WORK(&g1->poweroff_work, g1_poweroff_work);
 
 	if(pdata->type > G1_TYPE_MAX) {
 		err = -EINVAL;
@@ -886,6 +1668,33 @@ static struct g1 *g1_create(struct spi_device *spi,
 	g1->spi = spi;
 	g1->drv = g1_drv;
 	g1->drv.framesz = framesz;
+	g1->hot_timeout = hot_timeout_ms;
+
+	if(pdata->temp_curve_len != 0) {
+		err = g1_temp_curve_check(pdata->temp_curve,
+				pdata->temp_curve_len);
+		if(err < 0) {
+			ERR("Invalid temperature curve\n");
+			goto fail;
+		}
+		memcpy(g1->temp_curve, pdata->temp_curve,
+				pdata->temp_curve_len * sizeof(*g1->temp_curve));
+		g1->temp_curve_len = pdata->temp_curve_len;
+	} else {
+		memcpy(g1->temp_curve, g1_temp_profile[g1->type].curve,
+				g1_temp_profile[g1->type].curve_len *
+				sizeof(*g1->temp_curve));
+		g1->temp_curve_len = g1_temp_profile[g1->type].curve_len;
+	}
+
+	g1->stage_time_scale = 100;
+	if(pdata->stage_time_scale != 0)
+		g1->stage_time_scale = pdata->stage_time_scale;
+	if(g1->stage_time_scale > G1_STAGE_TIME_SCALE_MAX) {
+		ERR("Invalid stage time scale\n");
+		err = -EINVAL;
+		goto fail;
+	}
 
 	err = g1_prepare_gpios(g1);
 	if(err < 0)
@@ -899,12 +1708,37 @@ static struct g1 *g1_create(struct spi_device *spi,
 	if(err < 0)
 		goto fail;
 
+	err = g1_setup_stages(g1);
+	if(err < 0)
+		goto fail;
+
+	/* Ring size does not fit in an unsigned int past 4GiB */
+	if(check_mul_overflow((size_t)capture_kb, (size_t)1024, &cap_sz)) {
+		err = -EINVAL;
+		goto fail;
+	}
+	if(cap_sz >= sizeof(*g1->cap)) {
+		g1->cap_nr = rounddown_pow_of_two(cap_sz / sizeof(*g1->cap));
+		g1->cap = vmalloc(g1->cap_nr * sizeof(*g1->cap));
+		if(g1->cap == NULL) {
+			err = -ENOMEM;
+			goto fail;
+		}
+	}
+
 	epd = epd_create(&spi->dev, &g1->drv);
 	err = PTR_ERR_OR_ZERO(epd);
 	if(err < 0)
 		goto fail;
 
 	g1->epd = epd;
+	g1->id = epd_get_id(epd);
+
+	/* Power off stage does not depend on frame content, encode it once */
+	err = g1_encode_stage(g1, G1_STAGE_POWEROFF);
+	if(err < 0)
+		goto fail;
+
 	return g1;
 
 fail:
@@ -912,6 +1746,364 @@ fail:
 	return ERR_PTR(err);
 }
 
+static ssize_t temp_curve_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+	ssize_t len = 0;
+	size_t i;
+
+	mutex_lock(&g1->lock);
+	for(i = 0; i < g1->temp_curve_len; ++i)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s%d:%u",
+				(i == 0) ? "" : " ", g1->temp_curve[i].temp,
+				g1->temp_curve[i].factor);
+	mutex_unlock(&g1->lock);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+/*
+ * Curve is written as space separated "<temp mC>:<factor percent>" points
+ * sorted by increasing temperature (e.g. "0:300 20000:100 40000:70").
+ */
+static ssize_t temp_curve_store(struct device *dev,
+		struct device_attribute *attr, char const *buf, size_t count)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+	struct g1_temp_point curve[G1_TEMP_CURVE_MAX];
+	char const *p = buf;
+	size_t len = 0;
+	int ret, n;
+
+	while(*p != '\0' && *p != '\n') {
+		if(len == ARRAY_SIZE(curve))
+			return -EINVAL;
+		ret = sscanf(p, " %d:%u%n", &curve[len].temp,
+				&curve[len].factor, &n);
+		if(ret != 2)
+			return -EINVAL;
+		p += n;
+		++len;
+		while(*p == ' ')
+			++p;
+	}
+
+	ret = g1_temp_curve_check(curve, len);
+	if(ret < 0)
+		return ret;
+
+	mutex_lock(&g1->lock);
+	memcpy(g1->temp_curve, curve, len * sizeof(*curve));
+	g1->temp_curve_len = len;
+	mutex_unlock(&g1->lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(temp_curve);
+
+static ssize_t stage_time_scale_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", g1->stage_time_scale);
+}
+
+static ssize_t stage_time_scale_store(struct device *dev,
+		struct device_attribute *attr, char const *buf, size_t count)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+	unsigned int scale;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &scale);
+	if(ret < 0)
+		return ret;
+
+	if(scale == 0 || scale > G1_STAGE_TIME_SCALE_MAX)
+		return -EINVAL;
+
+	mutex_lock(&g1->lock);
+	g1->stage_time_scale = scale;
+	mutex_unlock(&g1->lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(stage_time_scale);
+
+static ssize_t stage_time_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", g1->stage_time);
+}
+static DEVICE_ATTR_RO(stage_time);
+
+static ssize_t pass_time_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+			(unsigned long long)div_u64(g1->pass_time,
+				NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(pass_time_us);
+
+static ssize_t line_time_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+			(unsigned long long)div_u64(g1->pass_time,
+				g1_frame_info[g1->type].line * NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(line_time_us);
+
+static ssize_t stage_passes_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", g1->passes);
+}
+static DEVICE_ATTR_RO(stage_passes);
+
+static ssize_t hot_timeout_ms_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(g1->hot_timeout));
+}
+
+static ssize_t hot_timeout_ms_store(struct device *dev,
+		struct device_attribute *attr, char const *buf, size_t count)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+	unsigned int timeout;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &timeout);
+	if(ret < 0)
+		return ret;
+
+	WRITE_ONCE(g1->hot_timeout, timeout);
+
+	/* Apply new timeout to a currently powered panel */
+	mutex_lock(&g1->hw_lock);
+	if(g1->powered)
+		mod_delayed_work(system_wq, &g1->poweroff_work,
+				msecs_to_jiffies(timeout));
+	mutex_unlock(&g1->hw_lock);
+
+	return count;
+}
+static DEVICE_ATTR_RW(hot_timeout_ms);
+
+static ssize_t stage_cache_hits_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", g1->stage_cache_hits);
+}
+static DEVICE_ATTR_RO(stage_cache_hits);
+
+static ssize_t stage_cache_misses_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", g1->stage_cache_misses);
+}
+static DEVICE_ATTR_RO(stage_cache_misses);
+
+static struct attribute *g1_attrs[] = {
+	&dev_attr_temp_curve.attr,
+	&dev_attr_stage_time_scale.attr,
+	&dev_attr_stage_time.attr,
+	&dev_attr_pass_time_us.attr,
+	&dev_attr_line_time_us.attr,
+	&dev_attr_stage_passes.attr,
+	&dev_attr_hot_timeout_ms.attr,
+	&dev_attr_stage_cache_hits.attr,
+	&dev_attr_stage_cache_misses.attr,
+	NULL,
+};
+
+static struct attribute_group const g1_attr_group = {
+	.attrs = g1_attrs,
+};
+
+static ssize_t g1_stages_show(u64 const *val, u64 div, char *buf)
+{
+	ssize_t len = 0;
+	unsigned int i;
+
+	for(i = 0; i < G1_STAGE_NR; ++i)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%llu%c",
+				(unsigned long long)div64_u64(val[i], div),
+				(i + 1 < G1_STAGE_NR) ? ' ' : '\n');
+	return len;
+}
+
+static ssize_t stage_time_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return g1_stages_show(g1->stats.stage_ns, NSEC_PER_USEC, buf);
+}
+static DEVICE_ATTR_RO(stage_time_us);
+
+static ssize_t passes_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return g1_stages_show(g1->stats.passes, 1, buf);
+}
+static DEVICE_ATTR_RO(passes);
+
+static ssize_t spi_bytes_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+			(unsigned long long)g1->stats.spi_bytes);
+}
+static DEVICE_ATTR_RO(spi_bytes);
+
+static ssize_t spi_transfers_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+			(unsigned long long)g1->stats.spi_xfers);
+}
+static DEVICE_ATTR_RO(spi_transfers);
+
+static ssize_t busy_wait_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+			(unsigned long long)div_u64(g1->stats.busy_ns,
+				NSEC_PER_USEC));
+}
+static DEVICE_ATTR_RO(busy_wait_us);
+
+static ssize_t temp_show(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	if(!READ_ONCE(g1->temp_valid))
+		return -ENODATA;
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(g1->temp));
+}
+static DEVICE_ATTR_RO(temp);
+
+static ssize_t reset_store(struct device *dev, struct device_attribute *attr,
+		char const *buf, size_t count)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	mutex_lock(&g1->hw_lock);
+	memset(&g1->stats, 0, sizeof(g1->stats));
+	mutex_unlock(&g1->hw_lock);
+	return count;
+}
+static DEVICE_ATTR_WO(reset);
+
+static struct attribute *g1_stats_attrs[] = {
+	&dev_attr_stage_time_us.attr,
+	&dev_attr_passes.attr,
+	&dev_attr_spi_bytes.attr,
+	&dev_attr_spi_transfers.attr,
+	&dev_attr_busy_wait_us.attr,
+	&dev_attr_temp.attr,
+	&dev_attr_reset.attr,
+	NULL,
+};
+
+static struct attribute_group const g1_stats_group = {
+	.name = "stats",
+	.attrs = g1_stats_attrs,
+};
+
+/*
+ * Read capture records from the oldest one, file position being the record
+ * sequence number times record size. Records overwritten since last read are
+ * skipped.
+ */
+static ssize_t g1_capture_read(struct file *f, char __user *buf, size_t len,
+		loff_t *off)
+{
+	struct g1 *g1 = f->private_data;
+	struct g1_capture_rec rec;
+	size_t done = 0;
+	u64 seq;
+
+	if(len < sizeof(rec))
+		return -EINVAL;
+
+	seq = div_u64(*off, sizeof(rec));
+	while(done + sizeof(rec) <= len) {
+		spin_lock(&g1->cap_lock);
+		if(seq < g1->cap_start)
+			seq = g1->cap_start;
+		if(g1->cap_seq - seq > g1->cap_nr)
+			seq = g1->cap_seq - g1->cap_nr;
+		if(seq >= g1->cap_seq) {
+			spin_unlock(&g1->cap_lock);
+			break;
+		}
+		rec = g1->cap[seq & (g1->cap_nr - 1)];
+		spin_unlock(&g1->cap_lock);
+
+		if(copy_to_user(buf + done, &rec, sizeof(rec))) {
+			if(done == 0)
+				return -EFAULT;
+			break;
+		}
+		done += sizeof(rec);
+		++seq;
+	}
+
+	*off = seq * sizeof(rec);
+	return done;
+}
+
+/* Any write discards captured records */
+static ssize_t g1_capture_write(struct file *f, char const __user *buf,
+		size_t len, loff_t *off)
+{
+	struct g1 *g1 = f->private_data;
+
+	spin_lock(&g1->cap_lock);
+	g1->cap_start = g1->cap_seq;
+	spin_unlock(&g1->cap_lock);
+	return len;
+}
+
+static struct file_operations const g1_capture_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = g1_capture_read,
+	.write = g1_capture_write,
+	.llseek = default_llseek,
+};
+
 #ifdef CONFIG_OF
 static const struct of_device_id g1_dt_ids[] = {
 	{
@@ -943,6 +2135,30 @@ static int g1_probe_dt(struct device *dev, struct g1_platform_data *pdata)
 	/* TODO Get type from DT */
 	pdata->type = G1_TYPE_2_7;
 
+	/* Optional temperature curve as <temp factor> cell pairs */
+	ret = of_property_count_u32_elems(node, "temp-curve");
+	if(ret > 0) {
+		if((ret % 2) || (ret / 2 > G1_TEMP_CURVE_MAX)) {
+			ERR("Invalid temp-curve property\n");
+			ret = -EINVAL;
+			goto out;
+		}
+		pdata->temp_curve_len = ret / 2;
+		ret = of_property_read_u32_array(node, "temp-curve",
+				(u32 *)pdata->temp_curve, ret);
+		if(ret < 0) {
+			ERR("Cannot read temp-curve property\n");
+			goto out;
+		}
+	} else {
+		pdata->temp_curve_len = 0;
+	}
+
+	pdata->stage_time_scale = 0;
+	of_property_read_u32(node, "stage-time-scale",
+			&pdata->stage_time_scale);
+	ret = 0;
+
 	/* Get gpio for panel_on */
 	pdata->gpio_panel_on = of_get_named_gpio(node, "panel_on-gpios", 0);
 	if(pdata->gpio_panel_on < 0) {
@@ -1030,6 +2246,29 @@ static int g1_probe(struct spi_device *spi)
 	}
 
 	spi_set_drvdata(spi, g1);
+
+	ret = sysfs_create_group(&spi->dev.kobj, &g1_attr_group);
+	if(ret < 0) {
+		ERR("Fail to create sysfs attributes\n");
+		g1_destroy(g1);
+		goto out;
+	}
+
+	ret = sysfs_create_group(&spi->dev.kobj, &g1_stats_group);
+	if(ret < 0) {
+		ERR("Fail to create sysfs statistics\n");
+		sysfs_remove_group(&spi->dev.kobj, &g1_attr_group);
+		g1_destroy(g1);
+		goto out;
+	}
+
+	/* debugfs failures are not fatal */
+	if(g1->cap != NULL) {
+		g1->debugfs = debugfs_create_dir(dev_name(&spi->dev),
+				g1_debugfs);
+		debugfs_create_file("capture", 0600, g1->debugfs, g1,
+				&g1_capture_fops);
+	}
 out:
 	return ret;
 }
@@ -1039,24 +2278,60 @@ static int g1_remove(struct spi_device *spi)
 	struct g1 *g1 = spi_get_drvdata(spi);
 	DBG("Call g1_remove()\n");
 
+	debugfs_remove_recursive(g1->debugfs);
+	sysfs_remove_group(&spi->dev.kobj, &g1_stats_group);
+	sysfs_remove_group(&spi->dev.kobj, &g1_attr_group);
 	g1_destroy(g1);
 	return 0;
 }
 
+#ifdef CONFIG_PM_SLEEP
+static int g1_suspend(struct device *dev)
+{
+	struct g1 *g1 = dev_get_drvdata(dev);
+
+	DBG("Call g1_suspend()\n");
+
+	/* Do not leave a hot panel powered during suspend */
+	return g1_sync_shutdown(g1);
+}
+#endif
+
 /**
- * TODO support pm suspend/resume
+ * TODO support pm resume
  */
+static SIMPLE_DEV_PM_OPS(g1_pm_ops, g1_suspend, NULL);
+
 static struct spi_driver g1_driver = {
 	.driver = {
 		.name = DRIVER_NAME,
 		.of_match_table = of_match_ptr(g1_dt_ids),
 		.owner = THIS_MODULE,
+		.pm = &g1_pm_ops,
 	},
 	.probe = g1_probe,
 	.remove = g1_remove,
 };
 
-module_spi_driver(g1_driver);
+static int __init g1_init(void)
+{
+	int ret;
+
+	g1_init_native_lut();
+	g1_debugfs = debugfs_create_dir("epd_g1", NULL);
+	ret = spi_register_driver(&g1_driver);
+	if(ret < 0)
+		debugfs_remove_recursive(g1_debugfs);
+	return ret;
+}
+module_init(g1_init);
+
+static void __exit g1_exit(void)
+{
+	spi_unregister_driver(&g1_driver);
+	debugfs_remove_recursive(g1_debugfs);
+}
+module_exit(g1_exit);
 
 MODULE_AUTHOR("Remi Pommarel <repk@triplefau.lt>");
 MODULE_DESCRIPTION(DRIVER_DESC);
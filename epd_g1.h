@@ -8,6 +8,27 @@ enum g1_screen_type {
 	G1_TYPE_MAX = G1_TYPE_2_7,
 };
 
+#define G1_TEMP_CURVE_MAX 16
+
+/**
+ * struct g1_temp_point - Point of temperature to stage time curve
+ * @temp: temperature in mC
+ * @factor: stage time multiplier in percent
+ *
+ * Stage time is linearly interpolated between two consecutive points and is
+ * clamped to the first/last point factor outside the curve.
+ */
+struct g1_temp_point {
+	int temp;
+	unsigned int factor;
+};
+
+/**
+ * struct g1_platform_data - COG G1 board description
+ * @temp_curve: temperature curve, points sorted by increasing temperature
+ * @temp_curve_len: number of points in @temp_curve, 0 for panel type default
+ * @stage_time_scale: scaling in percent of computed stage time, 0 for 100%
+ */
 struct g1_platform_data {
 	enum g1_screen_type type;
 	int gpio_panel_on;
@@ -15,6 +36,39 @@ struct g1_platform_data {
 	int gpio_border;
 	int gpio_busy;
 	int gpio_discharge;
+	struct g1_temp_point temp_curve[G1_TEMP_CURVE_MAX];
+	size_t temp_curve_len;
+	unsigned int stage_time_scale;
+};
+
+/* Capture record types */
+#define G1_CAP_SPI 0
+#define G1_CAP_GPIO 1
+#define G1_CAP_BUSY 2
+
+/* Chip select is released after the spi transfer */
+#define G1_CAP_CS_CHANGE (1 << 0)
+
+/**
+ * struct g1_capture_rec - SPI and GPIO capture record, as read from the
+ * epd_g1/<spi device>/capture debugfs file (host endian)
+ * @seq: record sequence number, a gap meaning records were overwritten
+ * @time_ns: CLOCK_MONOTONIC time of the operation
+ * @type: G1_CAP_* record type
+ * @flags: G1_CAP_CS_CHANGE for a spi transfer
+ * @len: spi transfer size, @data holding its first bytes
+ * @gpio: gpio set (@data[0] being its new value) or busy gpio released (@data
+ * holding the u64 wait time in ns)
+ * @data: record data
+ */
+struct g1_capture_rec {
+	__u64 seq;
+	__u64 time_ns;
+	__u8 type;
+	__u8 flags;
+	__u16 len;
+	__u32 gpio;
+	__u8 data[8];
 };
 
 #endif
@@ -0,0 +1,336 @@
+#ifndef EPD_G1_HOST
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/bitrev.h>
+#else
+#include <string.h>
+#endif
+
+#include "epd_g1_enc.h"
+
+#ifdef EPD_G1_HOST
+static inline u8 bitrev8(u8 b)
+{
+	b = (b >> 4) | (b << 4);
+	b = ((b >> 2) & 0x33) | ((b & 0x33) << 2);
+	b = ((b >> 1) & 0x55) | ((b & 0x55) << 1);
+	return b;
+}
+#endif
+
+struct epd_frame_size const g1_frame_info[] = {
+	[G1_TYPE_1_44] = {
+		.line = 96,
+		.col = 128,
+	},
+	[G1_TYPE_2] = {
+		.line = 96,
+		.col = 200,
+	},
+	[G1_TYPE_2_7] = {
+		.line = 176,
+		.col = 264,
+	},
+};
+
+
+u64 g1_hash(u64 hash, u8 const *data, size_t len)
+{
+	size_t i;
+
+	for(i = 0; i < len; ++i) {
+		hash ^= data[i];
+		hash *= G1_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+size_t g1_line_sz(enum g1_screen_type type)
+{
+	struct epd_frame_size const *fsz = &g1_frame_info[type];
+	size_t filler = 0;
+
+	switch(type) {
+	case G1_TYPE_1_44:
+		filler = 0;
+		break;
+	case G1_TYPE_2:
+	case G1_TYPE_2_7:
+		filler = 1;
+		break;
+	}
+
+	return fsz->col / G1_DOT_PER_BYTE + fsz->line / G1_SCAN_PER_BYTE +
+		filler;
+}
+
+size_t g1_img_sz(enum g1_screen_type type)
+{
+	struct epd_frame_size const *fsz = &g1_frame_info[type];
+
+	return sizeof(struct g1_img_hdr) +
+		fsz->line * DIV_ROUND_UP(fsz->col, 8) +
+		G1_STAGE_POWEROFF * fsz->line * g1_line_sz(type);
+}
+
+/* Check an encoded line only scans its own line, filler being blank */
+static int g1_check_line(u8 const *data, size_t line, size_t col,
+		size_t nrline, size_t len)
+{
+	size_t scan = col / 8, scannr = nrline / G1_SCAN_PER_BYTE, i;
+	u8 byte;
+
+	for(i = 0; i < scannr; ++i) {
+		byte = G1_SCAN_OFF;
+		if(i == line / G1_SCAN_PER_BYTE)
+			byte = 0xc0 >> (G1_SCAN_NRBIT *
+					(line % G1_SCAN_PER_BYTE));
+		if(data[scan + i] != byte)
+			return -EINVAL;
+	}
+
+	for(i = col / G1_DOT_PER_BYTE + scannr; i < len; ++i) {
+		if(data[i] != 0)
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+int g1_img_check(enum g1_screen_type type, void const *buf, size_t len)
+{
+	struct g1_img_hdr const *hdr = buf;
+	struct epd_frame_size const *fsz = &g1_frame_info[type];
+	size_t line_sz = g1_line_sz(type), i;
+	u8 const *data;
+	int ret;
+
+	if(len != g1_img_sz(type))
+		return -EINVAL;
+
+	if(le32_to_cpu(hdr->magic) != G1_IMG_MAGIC ||
+			le32_to_cpu(hdr->version) != G1_IMG_VERSION ||
+			le32_to_cpu(hdr->type) != type ||
+			le32_to_cpu(hdr->nrline) != fsz->line ||
+			le32_to_cpu(hdr->line_sz) != line_sz ||
+			le32_to_cpu(hdr->frame_sz) !=
+			fsz->line * DIV_ROUND_UP(fsz->col, 8))
+		return -EINVAL;
+
+	data = (u8 const *)(hdr + 1) + le32_to_cpu(hdr->frame_sz);
+	for(i = 0; i < G1_STAGE_POWEROFF * fsz->line; ++i) {
+		ret = g1_check_line(data + i * line_sz, i % fsz->line,
+				fsz->col, fsz->line, line_sz);
+		if(ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+#define G1_ODD_BYTE(dot) (dot)
+#define G1_EVEN_BYTE(dot)						\
+	(((((dot) >> 6) & 0x3) << 0) |					\
+	 ((((dot) >> 4) & 0x3) << 2) |					\
+	 ((((dot) >> 2) & 0x3) << 4) |					\
+	 ((((dot) >> 0) & 0x3) << 6))
+
+/* Encode odd dots of a frame byte, dot being masked with 0xaa */
+static inline u8 g1_odd_byte(enum g1_stage stage, u8 dot)
+{
+	switch(stage) {
+	case G1_STAGE_COMPENSATE:
+		return G1_ODD_BYTE(~(dot >> 1));
+	case G1_STAGE_WHITE:
+		return G1_ODD_BYTE(dot ^ 0xaa);
+	case G1_STAGE_INVERSE:
+		return G1_ODD_BYTE(~dot);
+	case G1_STAGE_NORMAL:
+		return G1_ODD_BYTE((dot >> 1) | 0xaa);
+	default:
+		return 0x55;
+	}
+}
+
+/* Encode even dots of a frame byte, dot being masked with 0x55 */
+static inline u8 g1_even_byte(enum g1_stage stage, u8 dot)
+{
+	switch(stage) {
+	case G1_STAGE_COMPENSATE:
+		return G1_EVEN_BYTE(~dot);
+	case G1_STAGE_WHITE:
+		return G1_EVEN_BYTE((dot ^ 0x55) << 1);
+	case G1_STAGE_INVERSE:
+		return G1_EVEN_BYTE((dot + 0x55) ^ 0xaa);
+	case G1_STAGE_NORMAL:
+		return G1_EVEN_BYTE(dot | 0xaa);
+	default:
+		return 0x55;
+	}
+}
+
+/*
+ * Native frame format: byte k of a line holds, in its odd bits (0xaa), the k-th
+ * transmitted odd dots byte and, in its even bits (0x55), the k-th transmitted
+ * even dots byte, i.e. plain line byte k even dots with their 2 bits dot slots
+ * in reversed order. Stage encoding is then a byte lookup in these tables.
+ */
+#define G1_LUT_ODD 0
+#define G1_LUT_EVEN 1
+static u8 g1_native_lut[G1_STAGE_POWEROFF][2][256];
+
+void g1_init_native_lut(void)
+{
+	unsigned int s, b;
+
+	for(s = 0; s < G1_STAGE_POWEROFF; ++s) {
+		for(b = 0; b < 256; ++b) {
+			g1_native_lut[s][G1_LUT_ODD][b] = g1_odd_byte(s,
+					b & 0xaa);
+			/* Dot slots reversal is its own inverse */
+			g1_native_lut[s][G1_LUT_EVEN][b] = g1_even_byte(s,
+					G1_EVEN_BYTE(b) & 0x55);
+		}
+	}
+}
+
+/* Get byte i of a frame line, walking it backward if frame is flipped */
+static inline u8 g1_line_byte(u8 const *row, size_t i, size_t lbyte,
+		bool hflip)
+{
+	if(hflip)
+		return bitrev8(row[lbyte - 1 - i]);
+	return row[i];
+}
+
+/*
+ * Frame flip and invert transforms are applied while reading dots.
+ */
+int g1_fill_line(struct epd_frame *frame, enum g1_stage stage, size_t line,
+		u8 *data, size_t len)
+{
+	u8 const *row = NULL;
+	u8 const *lut = NULL;
+	u8 *ptr, *end;
+	size_t lbyte, dotnr, scannr, i;
+	bool hflip = !!(frame->xform & EPD_XFORM_HFLIP);
+	u8 inv = (frame->xform & EPD_XFORM_INVERT) ? 0xff : 0;
+	int ret = 0;
+	u8 dot = 0;
+
+	dotnr = frame->nrdot / G1_DOT_PER_BYTE;
+	scannr = frame->nrline / G1_SCAN_PER_BYTE;
+	lbyte = frame->bytes_per_line;
+
+	/* Some length checking */
+	if((len < dotnr + scannr) || (dotnr != 2 * lbyte)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ptr = data;
+	end = data + len;
+
+	if(line != G1_DUMMY_LINE) {
+		row = frame->data + lbyte * ((frame->xform & EPD_XFORM_VFLIP) ?
+				frame->nrline - 1 - line : line);
+		if((frame->xform & EPD_XFORM_NATIVE) &&
+				stage != G1_STAGE_POWEROFF)
+			lut = g1_native_lut[stage][G1_LUT_ODD];
+	}
+
+	/* odd dots (263, ..., 3, 1) */
+	if(lut != NULL) {
+		for(i = 0; i < lbyte; ++i, ++ptr)
+			*ptr = lut[row[i]];
+	} else {
+		for(i = lbyte; i > 0; --i, ++ptr) {
+			if(row != NULL)
+				dot = g1_line_byte(row, i - 1, lbyte, hflip) ^
+					inv;
+			*ptr = g1_odd_byte(stage, dot & 0xaa);
+		}
+	}
+
+	/* Scan line */
+	for(i = 0; i < scannr; ++i, ++ptr) {
+		if(i == line / G1_SCAN_PER_BYTE) {
+			*ptr = 0xc0 >> (G1_SCAN_NRBIT *
+					(line % G1_SCAN_PER_BYTE));
+		} else {
+			*ptr = G1_SCAN_OFF;
+		}
+	}
+
+	/* even dots (0, 2, ..., 262) */
+	if(lut != NULL) {
+		lut = g1_native_lut[stage][G1_LUT_EVEN];
+		for(i = 0; i < lbyte; ++i, ++ptr)
+			*ptr = lut[row[i]];
+	} else {
+		for(i = 0; i < lbyte; ++i, ++ptr) {
+			if(row != NULL)
+				dot = g1_line_byte(row, i, lbyte, hflip) ^ inv;
+			*ptr = g1_even_byte(stage, dot & 0x55);
+		}
+	}
+
+	/* filler */
+	while(ptr < end)
+		*ptr++ = 0;
+
+out:
+	return ret;
+}
+
+int g1_encode_frame(struct epd_frame *frame, enum g1_stage stage, u8 *data,
+		size_t line_sz)
+{
+	size_t i;
+	int ret = 0;
+
+	for(i = 0; i < frame->nrline; ++i) {
+		ret = g1_fill_line(frame, stage, i, data + i * line_sz,
+				line_sz);
+		if(ret < 0)
+			break;
+	}
+
+	return ret;
+}
+
+int g1_img_build(enum g1_screen_type type, struct epd_frame *fold,
+		struct epd_frame *fnew, u8 *img)
+{
+	struct epd_frame_size const *fsz = &g1_frame_info[type];
+	struct g1_img_hdr *hdr = (struct g1_img_hdr *)img;
+	size_t frame_sz = fsz->line * DIV_ROUND_UP(fsz->col, 8);
+	size_t line_sz = g1_line_sz(type), i;
+	u8 *data;
+	int ret;
+
+	hdr->magic = cpu_to_le32(G1_IMG_MAGIC);
+	hdr->version = cpu_to_le32(G1_IMG_VERSION);
+	hdr->type = cpu_to_le32(type);
+	hdr->nrline = cpu_to_le32(fsz->line);
+	hdr->line_sz = cpu_to_le32(line_sz);
+	hdr->frame_sz = cpu_to_le32(frame_sz);
+	hdr->old_hash = cpu_to_le64(g1_hash(G1_HASH_INIT, fold->data,
+				frame_sz));
+
+	data = (u8 *)(hdr + 1);
+	memcpy(data, fnew->data, frame_sz);
+	data += frame_sz;
+
+	/* Same stages as the driver: old frame then new one */
+	for(i = 0; i < G1_STAGE_POWEROFF; ++i) {
+		ret = g1_encode_frame((i < G1_STAGE_INVERSE) ? fold : fnew, i,
+				data, line_sz);
+		if(ret < 0)
+			return ret;
+		data += fsz->line * line_sz;
+	}
+
+	return 0;
+}
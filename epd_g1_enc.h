@@ -0,0 +1,156 @@
+#ifndef _EPD_G1_ENC_H_
+#define _EPD_G1_ENC_H_
+
+/*
+ * COG G1 frame encoder, shared by the kernel driver and the g1-encode host
+ * tool (built with EPD_G1_HOST defined).
+ */
+#ifdef EPD_G1_HOST
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <linux/types.h>
+
+typedef uint8_t u8;
+typedef uint64_t u64;
+typedef int64_t ktime_t;
+
+struct device;
+
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define cpu_to_le32(x) ((uint32_t)(x))
+#define cpu_to_le64(x) ((uint64_t)(x))
+#else
+#define cpu_to_le32(x) __builtin_bswap32(x)
+#define cpu_to_le64(x) __builtin_bswap64(x)
+#endif
+#define le32_to_cpu(x) cpu_to_le32(x)
+#define le64_to_cpu(x) cpu_to_le64(x)
+#else
+#include <linux/types.h>
+#include <linux/ktime.h>
+#include <asm/byteorder.h>
+#endif
+
+#include "epd.h"
+#include "epd_g1.h"
+
+#define G1_DOT_NRBIT 2
+#define G1_DOT_PER_BYTE (8 / G1_DOT_NRBIT)
+#define G1_DOT_B 3
+#define G1_DOT_W 2
+#define G1_DOT_N 1
+#define G1_SCAN_NRBIT 2
+#define G1_SCAN_PER_BYTE (8 / G1_SCAN_NRBIT)
+#define G1_SCAN_OFF 0
+#define G1_SCAN_ON 3
+#define G1_DUMMY_LINE ((size_t)(-1))
+
+enum g1_stage {
+	G1_STAGE_COMPENSATE,
+	G1_STAGE_WHITE,
+	G1_STAGE_INVERSE,
+	G1_STAGE_NORMAL,
+	G1_STAGE_POWEROFF,
+};
+#define G1_STAGE_NR (G1_STAGE_POWEROFF + 1)
+
+extern struct epd_frame_size const g1_frame_info[];
+
+/*
+ * 64 bits FNV-1a hash
+ */
+#define G1_HASH_INIT 0xcbf29ce484222325ULL
+#define G1_HASH_PRIME 0x100000001b3ULL
+
+u64 g1_hash(u64 hash, u8 const *data, size_t len);
+
+#define G1_IMG_MAGIC 0x31474445 /* "EDG1" */
+#define G1_IMG_VERSION 1
+
+/**
+ * struct g1_img_hdr - Pre-encoded update header, fields are little endian
+ * @magic: G1_IMG_MAGIC
+ * @version: G1_IMG_VERSION
+ * @type: panel type (enum g1_screen_type)
+ * @nrline: panel number of lines
+ * @line_sz: encoded line size
+ * @frame_sz: new frame size
+ * @old_hash: g1_hash() of the frame the update is to be drawn over
+ *
+ * Header is followed by the new frame, then by the compensate, white, inverse
+ * and normal stages, each one being nrline encoded lines.
+ */
+struct g1_img_hdr {
+	__le32 magic;
+	__le32 version;
+	__le32 type;
+	__le32 nrline;
+	__le32 line_sz;
+	__le32 frame_sz;
+	__le64 old_hash;
+};
+
+/**
+ * g1_line_sz - Get encoded line size
+ * @type: panel type
+ */
+size_t g1_line_sz(enum g1_screen_type type);
+
+/**
+ * g1_img_sz - Get pre-encoded update size
+ * @type: panel type
+ */
+size_t g1_img_sz(enum g1_screen_type type);
+
+/**
+ * g1_img_check - Check a pre-encoded update
+ * @type: panel type to draw update on
+ * @buf: pre-encoded update
+ * @len: @buf size
+ *
+ * Header is checked against panel geometry and every encoded line is checked to
+ * scan its own line only.
+ */
+int g1_img_check(enum g1_screen_type type, void const *buf, size_t len);
+
+/**
+ * g1_init_native_lut - Build native format encoding tables, to be called once
+ * before encoding
+ */
+void g1_init_native_lut(void);
+
+/**
+ * g1_fill_line - Encode a frame line for a stage
+ * @frame: frame to encode, in panel geometry
+ * @stage: stage to encode line for
+ * @line: line to encode, or G1_DUMMY_LINE
+ * @data: encoded line
+ * @len: encoded line size
+ */
+int g1_fill_line(struct epd_frame *frame, enum g1_stage stage, size_t line,
+		u8 *data, size_t len);
+
+/**
+ * g1_encode_frame - Encode all lines of a frame for a stage
+ * @frame: frame to encode, in panel geometry
+ * @stage: stage to encode frame for
+ * @data: encoded lines
+ * @line_sz: encoded line size
+ */
+int g1_encode_frame(struct epd_frame *frame, enum g1_stage stage, u8 *data,
+		size_t line_sz);
+
+/**
+ * g1_img_build - Pre-encode an update
+ * @type: panel type
+ * @fold: frame update is to be drawn over, untransformed
+ * @fnew: frame to draw, untransformed
+ * @img: pre-encoded update, g1_img_sz() bytes
+ */
+int g1_img_build(enum g1_screen_type type, struct epd_frame *fold,
+		struct epd_frame *fnew, u8 *img);
+
+#endif
@@ -0,0 +1,146 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM epd_g1
+
+#if !defined(_EPD_G1_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _EPD_G1_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#include "epd_g1_enc.h"
+
+#ifndef _EPD_G1_TRACE_DEFS_
+#define _EPD_G1_TRACE_DEFS_
+/* Power sequence steps, each one lasting until the next one */
+#define G1_TRACE_POWER_ON 0
+#define G1_TRACE_RESET 1
+#define G1_TRACE_INIT 2
+#define G1_TRACE_READY 3
+#define G1_TRACE_POWER_OFF 4
+#define G1_TRACE_BORDER 5
+#define G1_TRACE_DISCHARGE 6
+#define G1_TRACE_OFF 7
+#endif
+
+TRACE_DEFINE_ENUM(G1_STAGE_COMPENSATE);
+TRACE_DEFINE_ENUM(G1_STAGE_WHITE);
+TRACE_DEFINE_ENUM(G1_STAGE_INVERSE);
+TRACE_DEFINE_ENUM(G1_STAGE_NORMAL);
+TRACE_DEFINE_ENUM(G1_STAGE_POWEROFF);
+
+#define show_g1_stage(stage)						\
+	__print_symbolic(stage,						\
+			{ G1_STAGE_COMPENSATE, "compensate" },		\
+			{ G1_STAGE_WHITE, "white" },			\
+			{ G1_STAGE_INVERSE, "inverse" },		\
+			{ G1_STAGE_NORMAL, "normal" },			\
+			{ G1_STAGE_POWEROFF, "poweroff" })
+
+#define show_g1_power(step)						\
+	__print_symbolic(step,						\
+			{ G1_TRACE_POWER_ON, "power_on" },		\
+			{ G1_TRACE_RESET, "reset" },			\
+			{ G1_TRACE_INIT, "init" },			\
+			{ G1_TRACE_READY, "ready" },			\
+			{ G1_TRACE_POWER_OFF, "power_off" },		\
+			{ G1_TRACE_BORDER, "border" },			\
+			{ G1_TRACE_DISCHARGE, "discharge" },		\
+			{ G1_TRACE_OFF, "off" })
+
+/* Events id is the one of the panel screen, as traced by epd events */
+TRACE_EVENT(g1_power,
+	TP_PROTO(unsigned int id, unsigned int step),
+	TP_ARGS(id, step),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(unsigned int, step)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->step = step;
+	),
+	TP_printk("epd%u %s", __entry->id, show_g1_power(__entry->step))
+);
+
+TRACE_EVENT(g1_stage_start,
+	TP_PROTO(unsigned int id, unsigned int stage, unsigned long stage_time),
+	TP_ARGS(id, stage, stage_time),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(unsigned int, stage)
+		__field(unsigned long, stage_time)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->stage = stage;
+		__entry->stage_time = stage_time;
+	),
+	TP_printk("epd%u %s stage_time=%lums", __entry->id,
+			show_g1_stage(__entry->stage), __entry->stage_time)
+);
+
+TRACE_EVENT(g1_stage_end,
+	TP_PROTO(unsigned int id, unsigned int stage, unsigned int passes,
+		u64 pass_ns),
+	TP_ARGS(id, stage, passes, pass_ns),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(unsigned int, stage)
+		__field(unsigned int, passes)
+		__field(u64, pass_ns)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->stage = stage;
+		__entry->passes = passes;
+		__entry->pass_ns = pass_ns;
+	),
+	TP_printk("epd%u %s passes=%u pass=%lluns", __entry->id,
+			show_g1_stage(__entry->stage), __entry->passes,
+			__entry->pass_ns)
+);
+
+/* Line pass counts from 0, the power off stage having a single one */
+TRACE_EVENT(g1_line,
+	TP_PROTO(unsigned int id, unsigned int stage, unsigned int pass,
+		unsigned int line, size_t len),
+	TP_ARGS(id, stage, pass, line, len),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(unsigned int, stage)
+		__field(unsigned int, pass)
+		__field(unsigned int, line)
+		__field(size_t, len)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->stage = stage;
+		__entry->pass = pass;
+		__entry->line = line;
+		__entry->len = len;
+	),
+	TP_printk("epd%u %s pass=%u line=%u len=%zu", __entry->id,
+			show_g1_stage(__entry->stage), __entry->pass,
+			__entry->line, __entry->len)
+);
+
+TRACE_EVENT(g1_busy_wait,
+	TP_PROTO(unsigned int id, u64 ns),
+	TP_ARGS(id, ns),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->ns = ns;
+	),
+	TP_printk("epd%u %lluns", __entry->id, __entry->ns)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE epd_g1_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,222 @@
+#ifndef _EPD_IOCTL_H_
+#define _EPD_IOCTL_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * Framebuffer (/dev/epd<id>) ioctls. Frames are stored line by line, pixel x
+ * of a line being bit (x % 8) of byte (x / 8), a set bit being a black pixel.
+ */
+
+/* Display new frame once the operation is done */
+#define EPD_RECT_DRAW (1 << 0)
+
+/**
+ * struct epd_blit - Rectangle write into new frame
+ * @x: rectangle left column in pixels
+ * @y: rectangle top line
+ * @w: rectangle width in pixels
+ * @h: rectangle height in lines
+ * @stride: bytes between two lines of @data
+ * @flags: EPD_RECT_* flags
+ * @data: user pointer to rectangle pixels, each line starting at pixel 0 of
+ * its first byte
+ */
+struct epd_blit {
+	__u32 x;
+	__u32 y;
+	__u32 w;
+	__u32 h;
+	__u32 stride;
+	__u32 flags;
+	__u64 data;
+};
+
+/**
+ * struct epd_rect - Rectangle operation on new frame
+ * @x: rectangle left column in pixels
+ * @y: rectangle top line
+ * @w: rectangle width in pixels
+ * @h: rectangle height in lines
+ * @flags: EPD_RECT_* flags
+ * @color: fill color, 0 for white, black otherwise (unused by invert)
+ */
+struct epd_rect {
+	__u32 x;
+	__u32 y;
+	__u32 w;
+	__u32 h;
+	__u32 flags;
+	__u32 color;
+};
+
+/**
+ * struct epd_copy - Rectangle copy inside new frame, source and destination
+ * rectangles can overlap (e.g. scrolling)
+ * @x: destination rectangle left column in pixels
+ * @y: destination rectangle top line
+ * @w: rectangle width in pixels
+ * @h: rectangle height in lines
+ * @flags: EPD_RECT_* flags
+ * @sx: source rectangle left column in pixels
+ * @sy: source rectangle top line
+ */
+struct epd_copy {
+	__u32 x;
+	__u32 y;
+	__u32 w;
+	__u32 h;
+	__u32 flags;
+	__u32 sx;
+	__u32 sy;
+};
+
+/**
+ * struct epd_encoded - Driver specific pre-encoded update
+ * @data: user pointer to the update
+ * @len: update size
+ */
+struct epd_encoded {
+	__u64 data;
+	__u64 len;
+};
+
+/* Draw frame even if it is already displayed */
+#define EPD_SUBMIT_FORCE (1 << 0)
+/* Draw frame so that it shows at deadline (EPD_IOC_DRAW only) */
+#define EPD_SUBMIT_DEADLINE (1 << 2)
+
+/**
+ * struct epd_submit - Whole new frame write and draw, done atomically
+ * @data: user pointer to frame pixels
+ * @len: @data size, must be the frame size
+ * @flags: EPD_SUBMIT_* flags
+ */
+struct epd_submit {
+	__u64 data;
+	__u32 len;
+	__u32 flags;
+};
+
+/* Ring submission frame is a slot number (see struct epd_ring_sqe) */
+#define EPD_RING_SLOT (1 << 1)
+
+#define EPD_RING_MAX_ENTRIES 64
+
+/**
+ * struct epd_ring_setup - Submission ring setup, ring being then mapped with
+ * mmap() at offset 0 of /dev/epd<id>
+ * @entries: number of submission and completion entries as well as of ring
+ * frames, a power of 2 up to EPD_RING_MAX_ENTRIES
+ * @frame_sz: (out) ring frame size, that is new frame size
+ * @sq_off: (out) offset of the struct epd_ring_sqe array
+ * @cq_off: (out) offset of the struct epd_ring_cqe array
+ * @frames_off: (out) offset of ring frames
+ * @size: (out) ring size to map
+ */
+struct epd_ring_setup {
+	__u32 entries;
+	__u32 frame_sz;
+	__u32 sq_off;
+	__u32 cq_off;
+	__u32 frames_off;
+	__u32 size;
+};
+
+/**
+ * struct epd_ring_hdr - Ring header, at offset 0. An entry is at index
+ * (head or tail) & (entries - 1) of its array.
+ * @sq_head: first submission not consumed yet, written by kernel
+ * @sq_tail: next submission, written by userspace
+ * @cq_head: first completion not consumed yet, written by userspace
+ * @cq_tail: next completion, written by kernel
+ * @entries: number of entries
+ */
+struct epd_ring_hdr {
+	__u32 sq_head;
+	__u32 sq_tail;
+	__u32 cq_head;
+	__u32 cq_tail;
+	__u32 entries;
+};
+
+/**
+ * struct epd_ring_sqe - Ring frame submission
+ * @user_data: copied to completion
+ * @time_ns: CLOCK_MONOTONIC time not to display frame before, 0 for now
+ * @frame: ring frame index, or slot with EPD_RING_SLOT
+ * @flags: EPD_SUBMIT_* and EPD_RING_* flags
+ */
+struct epd_ring_sqe {
+	__u64 user_data;
+	__u64 time_ns;
+	__u32 frame;
+	__u32 flags;
+};
+
+/**
+ * struct epd_ring_cqe - Ring frame completion
+ * @user_data: submission user_data
+ * @time_ns: CLOCK_MONOTONIC time frame was displayed at
+ * @res: 0 or negative error code
+ */
+struct epd_ring_cqe {
+	__u64 user_data;
+	__u64 time_ns;
+	__s32 res;
+	__u32 pad;
+};
+
+/* Update prediction panel power states */
+#define EPD_PREDICT_NOW 0
+#define EPD_PREDICT_COLD 1
+#define EPD_PREDICT_HOT 2
+
+/**
+ * struct epd_predict - New frame draw duration prediction
+ * @power: EPD_PREDICT_* panel power state to predict update for, that is as
+ * it is now, powered off or kept powered from a previous update
+ * @pad: reserved, 0
+ * @duration_ns: (out) update duration
+ * @shown_ns: (out) time from update start to new frame starting to show, as
+ * targeted by EPD_SUBMIT_DEADLINE
+ */
+struct epd_predict {
+	__u32 power;
+	__u32 pad;
+	__u64 duration_ns;
+	__u64 shown_ns;
+};
+
+/**
+ * struct epd_draw - New frame draw, as 'W<id>' on /dev/epdctl
+ * @flags: EPD_SUBMIT_* flags
+ * @clock: EPD_SUBMIT_DEADLINE clock, CLOCK_MONOTONIC or CLOCK_REALTIME
+ * @deadline_ns: EPD_SUBMIT_DEADLINE absolute time, in @clock
+ *
+ * With EPD_SUBMIT_DEADLINE, the draw returns once done, the gap between
+ * deadline and the time frame actually showed being reported in the screen
+ * deadline_latency_ns sysfs attribute. Deadline cannot be more than 60s away
+ * (-ERANGE), a signal interrupts the wait for it (-EINTR).
+ */
+struct epd_draw {
+	__u32 flags;
+	__u32 clock;
+	__u64 deadline_ns;
+};
+
+#define EPD_IOC_MAGIC 'E'
+
+#define EPD_IOC_BLIT _IOW(EPD_IOC_MAGIC, 0, struct epd_blit)
+#define EPD_IOC_FILL _IOW(EPD_IOC_MAGIC, 1, struct epd_rect)
+#define EPD_IOC_INVERT _IOW(EPD_IOC_MAGIC, 2, struct epd_rect)
+#define EPD_IOC_COPY _IOW(EPD_IOC_MAGIC, 3, struct epd_copy)
+#define EPD_IOC_DRAW_ENCODED _IOW(EPD_IOC_MAGIC, 4, struct epd_encoded)
+#define EPD_IOC_SUBMIT _IOW(EPD_IOC_MAGIC, 5, struct epd_submit)
+#define EPD_IOC_DRAW _IOW(EPD_IOC_MAGIC, 6, struct epd_draw)
+#define EPD_IOC_RING_SETUP _IOWR(EPD_IOC_MAGIC, 8, struct epd_ring_setup)
+#define EPD_IOC_RING_KICK _IO(EPD_IOC_MAGIC, 9)
+#define EPD_IOC_PREDICT _IOWR(EPD_IOC_MAGIC, 10, struct epd_predict)
+
+#endif
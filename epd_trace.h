@@ -0,0 +1,122 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM epd
+
+#if !defined(_EPD_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _EPD_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+/*
+ * Screen update tracepoints, driver specific steps being traced by the driver
+ * own trace system (e.g. epd_g1).
+ */
+
+#ifndef _EPD_TRACE_DEFS_
+#define _EPD_TRACE_DEFS_
+/* Committed update kinds */
+#define EPD_TRACE_FRAME 0
+#define EPD_TRACE_FILL 1
+#define EPD_TRACE_SLOT 2
+#define EPD_TRACE_ENCODED 3
+#endif
+
+#define show_epd_kind(kind)						\
+	__print_symbolic(kind,						\
+			{ EPD_TRACE_FRAME, "frame" },			\
+			{ EPD_TRACE_FILL, "fill" },			\
+			{ EPD_TRACE_SLOT, "slot" },			\
+			{ EPD_TRACE_ENCODED, "encoded" })
+
+TRACE_EVENT(epd_commit,
+	TP_PROTO(unsigned int id, unsigned int kind, ktime_t deadline),
+	TP_ARGS(id, kind, deadline),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(unsigned int, kind)
+		__field(s64, deadline)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->kind = kind;
+		__entry->deadline = ktime_to_ns(deadline);
+	),
+	TP_printk("epd%u %s deadline=%lld", __entry->id,
+			show_epd_kind(__entry->kind), __entry->deadline)
+);
+
+TRACE_EVENT(epd_commit_done,
+	TP_PROTO(unsigned int id, int ret),
+	TP_ARGS(id, ret),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->ret = ret;
+	),
+	TP_printk("epd%u ret=%d", __entry->id, __entry->ret)
+);
+
+TRACE_EVENT(epd_skip,
+	TP_PROTO(unsigned int id, unsigned int kind),
+	TP_ARGS(id, kind),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(unsigned int, kind)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->kind = kind;
+	),
+	TP_printk("epd%u %s already displayed", __entry->id,
+			show_epd_kind(__entry->kind))
+);
+
+TRACE_EVENT(epd_ring_sqe,
+	TP_PROTO(unsigned int id, u64 user_data, u32 frame, u32 flags,
+		u64 time_ns),
+	TP_ARGS(id, user_data, frame, flags, time_ns),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(u64, user_data)
+		__field(u32, frame)
+		__field(u32, flags)
+		__field(u64, time_ns)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->user_data = user_data;
+		__entry->frame = frame;
+		__entry->flags = flags;
+		__entry->time_ns = time_ns;
+	),
+	TP_printk("epd%u user_data=%llu frame=%u flags=%#x time=%llu",
+			__entry->id, __entry->user_data, __entry->frame,
+			__entry->flags, __entry->time_ns)
+);
+
+TRACE_EVENT(epd_ring_cqe,
+	TP_PROTO(unsigned int id, u64 user_data, int res),
+	TP_ARGS(id, user_data, res),
+	TP_STRUCT__entry(
+		__field(unsigned int, id)
+		__field(u64, user_data)
+		__field(int, res)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->user_data = user_data;
+		__entry->res = res;
+	),
+	TP_printk("epd%u user_data=%llu res=%d", __entry->id,
+			__entry->user_data, __entry->res)
+);
+
+#endif
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE epd_trace
+#include <trace/define_trace.h>
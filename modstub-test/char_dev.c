@@ -4,6 +4,13 @@
 #include <linux/types.h>
 #include <linux/list.h>
 #include <linux/cdev.h>
+#include <linux/mm.h>
+
+/* Pipe holding a single buffer */
+struct pipe_inode_info {
+	char const *buf;
+	size_t len;
+};
 
 struct chrdev {
 	struct list_head next;
@@ -58,10 +65,8 @@ void cdev_init(struct cdev *cdev, struct file_operations const *fops)
 
 int cdev_add(struct cdev *p, dev_t dev, unsigned count)
 {
-	(void)p;
-	(void)count;
-
 	p->dev = dev;
+	p->count = count;
 	list_add_tail(&p->next, &cdevlst);
 	return 0;
 }
@@ -77,13 +82,12 @@ static struct cdev *cdev_find(dev_t dev)
 	struct cdev *cdev;
 
 	list_for_each_entry(cdev, &cdevlst, next) {
-		if(cdev->dev == dev)
-			break;
+		if(MAJOR(cdev->dev) == MAJOR(dev) &&
+				MINOR(dev) - MINOR(cdev->dev) < cdev->count)
+			return cdev;
 	}
 
-	if(cdev->dev != dev)
-		return NULL;
-	return cdev;
+	return NULL;
 }
 
 static struct file *cdev_find_file(int fd)
@@ -130,6 +134,23 @@ int cdev_open(struct inode *i)
 	return f->fd;
 }
 
+static ssize_t cdev_write_iter(struct file *f, char const *buf, size_t len,
+		loff_t *off)
+{
+	struct kiocb iocb = {
+		.ki_filp = f,
+		.ki_pos = *off,
+	};
+	struct iov_iter iter;
+	ssize_t ret;
+
+	iov_iter_init(&iter, buf, len);
+	ret = f->f_op->write_iter(&iocb, &iter);
+	if(ret > 0)
+		*off = iocb.ki_pos;
+	return ret;
+}
+
 int cdev_write(int fd, char const *buf, size_t len, loff_t *off)
 {
 	struct file *f;
@@ -138,7 +159,40 @@ int cdev_write(int fd, char const *buf, size_t len, loff_t *off)
 	if(f == NULL)
 		return -ENODEV;
 
-	return f->f_op->write(f, buf, len, off);
+	if(f->f_op->write != NULL)
+		return f->f_op->write(f, buf, len, off);
+
+	return cdev_write_iter(f, buf, len, off);
+}
+
+ssize_t iter_file_splice_write(struct pipe_inode_info *pipe, struct file *out,
+		loff_t *ppos, size_t len, unsigned int flags)
+{
+	(void)flags;
+
+	if(len > pipe->len)
+		len = pipe->len;
+
+	return cdev_write_iter(out, pipe->buf, len, ppos);
+}
+
+/* Splice a buffer into a file, as sendfile() from a file would */
+int cdev_splice(int fd, char const *buf, size_t len, loff_t *off)
+{
+	struct pipe_inode_info pipe = {
+		.buf = buf,
+		.len = len,
+	};
+	struct file *f;
+
+	f = cdev_find_file(fd);
+	if(f == NULL)
+		return -ENODEV;
+
+	if(f->f_op->splice_write == NULL)
+		return -EINVAL;
+
+	return f->f_op->splice_write(&pipe, f, off, len, 0);
 }
 
 int cdev_read(int fd, char *buf, size_t len, loff_t *off)
@@ -152,6 +206,39 @@ int cdev_read(int fd, char *buf, size_t len, loff_t *off)
 	return f->f_op->read(f, buf, len, off);
 }
 
+long cdev_ioctl(int fd, unsigned int cmd, void *arg)
+{
+	struct file *f;
+
+	f = cdev_find_file(fd);
+	if(f == NULL)
+		return -ENODEV;
+
+	if(f->f_op->unlocked_ioctl == NULL)
+		return -ENOTTY;
+
+	return f->f_op->unlocked_ioctl(f, cmd, (unsigned long)arg);
+}
+
+/* Map a file, NULL on error */
+void *cdev_mmap(int fd, size_t len, loff_t off)
+{
+	struct vm_area_struct vma = {
+		.vm_end = len,
+		.vm_pgoff = off / PAGE_SIZE,
+	};
+	struct file *f;
+
+	f = cdev_find_file(fd);
+	if(f == NULL || f->f_op->mmap == NULL)
+		return NULL;
+
+	if(f->f_op->mmap(f, &vma) < 0)
+		return NULL;
+
+	return (void *)vma.vm_start;
+}
+
 void cdev_close(int fd)
 {
 	struct file *f;
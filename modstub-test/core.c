@@ -13,7 +13,6 @@ struct device *device_create_vargs(struct class *class, struct device *parent,
 	size_t len;
 
 	(void)class;
-	(void)parent;
 
 	dev = kzalloc(sizeof(*dev), GFP_KERNEL);
 	if(dev == NULL)
@@ -27,6 +26,7 @@ struct device *device_create_vargs(struct class *class, struct device *parent,
 
 	vsnprintf(name, 1024, fmt, args);
 
+	dev->parent = parent;
 	dev->devt = devt;
 	dev->name = name;
 	INIT_LIST_HEAD(&dev->next);
@@ -50,6 +50,38 @@ struct device *device_create(struct class *class, struct device *parent,
 	return dev;
 }
 
+struct device *device_create_with_groups(struct class *class,
+		struct device *parent, dev_t devt, void *drvdata,
+		struct attribute_group const **groups, char const *fmt, ...)
+{
+	struct device *dev;
+	va_list vargs;
+
+	va_start(vargs, fmt);
+	dev = device_create_vargs(class, parent, devt, drvdata, fmt, vargs);
+	va_end(vargs);
+
+	if(IS_ERR(dev))
+		return dev;
+
+	for(; groups != NULL && *groups != NULL; ++groups)
+		sysfs_create_group(&dev->kobj, *groups);
+
+	return dev;
+}
+
+struct device *device_find(dev_t devt)
+{
+	struct device *dev;
+
+	list_for_each_entry(dev, &devlst, next) {
+		if(dev->devt == devt)
+			return dev;
+	}
+
+	return NULL;
+}
+
 void device_destroy(struct class *class, dev_t devt)
 {
 	struct device *dev = NULL;
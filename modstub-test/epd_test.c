@@ -1,5 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
 
 #include <linux/module.h>
 #include <linux/spi/spi.h>
@@ -7,8 +10,14 @@
 #include <linux/kdev_t.h>
 #include <linux/cdev.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+
+#include <spilog.h>
 
 #include "../epd_g1.h"
+#include "../epd_g1_enc.h"
+#include "../epd_ioctl.h"
 
 static struct g1_platform_data pdata = {
 	.type = G1_TYPE_2_7,
@@ -36,10 +45,487 @@ static struct inode epd0 = {
 	.i_rdev = MKDEV(1, 1),
 };
 
-int main(void)
+/* Failed checks, epd_test exits with an error if any */
+static unsigned int failed;
+
+#define CHECK(cond, ...) do {						\
+	if(!(cond)) {							\
+		printk(__VA_ARGS__);					\
+		++failed;						\
+	}								\
+} while(0)
+
+/* 2.7" panel frame, as read from /dev/epd0 */
+#define FRAME_LINE 176
+#define FRAME_COL 264
+#define FRAME_BPL (FRAME_COL / 8)
+#define FRAME_SZ (FRAME_LINE * FRAME_BPL)
+
+/*
+ * Reference frame operations, pixel x of a line being bit (x % 8) of byte
+ * (x / 8), a set bit being a black pixel.
+ */
+static int ref_get(u8 const *f, unsigned int x, unsigned int y)
+{
+	return (f[y * FRAME_BPL + x / 8] >> (x % 8)) & 1;
+}
+
+static void ref_set(u8 *f, unsigned int x, unsigned int y, int black)
+{
+	u8 *b = &f[y * FRAME_BPL + x / 8];
+
+	if(black)
+		*b |= 1 << (x % 8);
+	else
+		*b &= ~(1 << (x % 8));
+}
+
+static void ref_blit(u8 *f, struct epd_blit const *b, u8 const *data)
+{
+	unsigned int x, y;
+
+	for(y = 0; y < b->h; ++y)
+		for(x = 0; x < b->w; ++x)
+			ref_set(f, b->x + x, b->y + y,
+					(data[y * b->stride + x / 8] >> (x % 8)) & 1);
+}
+
+static void ref_fill(u8 *f, struct epd_rect const *r)
+{
+	unsigned int x, y;
+
+	for(y = 0; y < r->h; ++y)
+		for(x = 0; x < r->w; ++x)
+			ref_set(f, r->x + x, r->y + y, r->color != 0);
+}
+
+static void ref_invert(u8 *f, struct epd_rect const *r)
+{
+	unsigned int x, y;
+
+	for(y = 0; y < r->h; ++y)
+		for(x = 0; x < r->w; ++x)
+			ref_set(f, r->x + x, r->y + y,
+					!ref_get(f, r->x + x, r->y + y));
+}
+
+static void ref_copy(u8 *f, struct epd_copy const *c)
+{
+	static u8 src[FRAME_SZ];
+	unsigned int x, y;
+
+	memcpy(src, f, sizeof(src));
+	for(y = 0; y < c->h; ++y)
+		for(x = 0; x < c->w; ++x)
+			ref_set(f, c->x + x, c->y + y,
+					ref_get(src, c->sx + x, c->sy + y));
+}
+
+/* Read an unsigned sysfs attribute, all ones if it cannot be read */
+static unsigned long long attr_read(struct device *dev, char const *name)
+{
+	char buf[32];
+
+	if(device_attr_show(dev, name, buf) < 0)
+		return -1ULL;
+	return strtoull(buf, NULL, 10);
+}
+
+/* Read a frame back, new frame at offset 0, and compare it to expected one */
+static void frame_check(int fd, loff_t off, u8 const *ref, char const *what)
 {
+	static u8 frame[FRAME_SZ];
+	size_t i;
+	int ret;
+
+	ret = cdev_read(fd, (char *)frame, sizeof(frame), &off);
+	CHECK(ret == FRAME_SZ, "%s: read %d bytes\n", what, ret);
+	for(i = 0; i < FRAME_SZ && frame[i] == ref[i]; ++i)
+		;
+	CHECK(i == FRAME_SZ, "%s: frame differs at line %zu byte %zu\n",
+			what, i / FRAME_BPL, i % FRAME_BPL);
+}
+
+/*
+ * Reference panel frame of user frame for a panel mounted rotated by rotate
+ * degrees, images being mirrored then inverted, user frame being 176 dots wide
+ * for a 90 or 270 degrees rotation.
+ */
+static void ref_orient(u8 *panel, u8 const *user, unsigned int rotate,
+		bool mirror, bool invert)
+{
+	unsigned int x, y, ux, uy, uw = (rotate % 180) ? FRAME_LINE : FRAME_COL;
+
+	for(y = 0; y < FRAME_LINE; ++y) {
+		for(x = 0; x < FRAME_COL; ++x) {
+			switch(rotate) {
+			case 90:
+				ux = FRAME_LINE - 1 - y;
+				uy = x;
+				break;
+			case 180:
+				ux = FRAME_COL - 1 - x;
+				uy = FRAME_LINE - 1 - y;
+				break;
+			case 270:
+				ux = y;
+				uy = FRAME_COL - 1 - x;
+				break;
+			default:
+				ux = x;
+				uy = y;
+			}
+			if(mirror)
+				ux = uw - 1 - ux;
+			ref_set(panel, x, y, invert ^
+					((user[uy * (uw / 8) + ux / 8] >>
+					  (ux % 8)) & 1));
+		}
+	}
+}
+
+/*
+ * Draw user frame with orientation attribute set to val, and its reference
+ * panel frame without, both over a blank panel, spi log must be the same.
+ */
+static void orient_check(int fd, char const *attr, char const *val,
+		u8 const *user, u8 const *panel)
+{
+	struct device *screen = device_find(epd0.i_rdev);
+	struct epd_submit sub = {
+		.len = FRAME_SZ,
+		.flags = EPD_SUBMIT_FORCE,
+	};
+	static u8 const blank[FRAME_SZ];
+	u64 hash, nr, ref_hash, ref_nr;
+
+	device_attr_store(screen, "rotate", "0");
+	device_attr_store(screen, "mirror", "0");
+	device_attr_store(screen, "invert", "0");
+	sub.data = (uintptr_t)blank;
+	CHECK(cdev_ioctl(fd, EPD_IOC_SUBMIT, &sub) == 0,
+			"%s %s: cannot clear\n", attr, val);
+	spilog_hash_start();
+	sub.data = (uintptr_t)panel;
+	CHECK(cdev_ioctl(fd, EPD_IOC_SUBMIT, &sub) == 0,
+			"%s %s: cannot draw reference\n", attr, val);
+	ref_hash = spilog_hash(&ref_nr);
+
+	sub.data = (uintptr_t)blank;
+	CHECK(cdev_ioctl(fd, EPD_IOC_SUBMIT, &sub) == 0,
+			"%s %s: cannot clear\n", attr, val);
+	CHECK(device_attr_store(screen, attr, val) >= 0,
+			"Cannot set %s to %s\n", attr, val);
+	spilog_hash_start();
+	sub.data = (uintptr_t)user;
+	CHECK(cdev_ioctl(fd, EPD_IOC_SUBMIT, &sub) == 0,
+			"%s %s: cannot draw\n", attr, val);
+	hash = spilog_hash(&nr);
+	CHECK(ref_nr != 0 && nr == ref_nr && hash == ref_hash,
+			"%s %s: panel frame differs from reference\n", attr,
+			val);
+	frame_check(fd, 0, user, attr);
+}
+
+/*
+ * Draw black through the fill fast path and then as an encoded frame, both
+ * over a blank panel. Spi log must be the same, frames being flipped so that
+ * neither update is found in stage cache.
+ */
+static void fill_check(int fd, int fctl)
+{
+	struct device *screen = device_find(epd0.i_rdev);
+	struct epd_submit sub = {
+		.len = FRAME_SZ,
+		.flags = EPD_SUBMIT_FORCE,
+	};
+	static u8 const blank[FRAME_SZ];
+	static u8 black[FRAME_SZ];
+	unsigned long long misses;
+	u64 hash, nr, fill_hash, fill_nr;
 	loff_t off = 0;
-	int ret, fctl;
+
+	memset(black, 0xff, sizeof(black));
+	device_attr_store(screen, "rotate", "180");
+	sub.data = (uintptr_t)blank;
+	CHECK(cdev_ioctl(fd, EPD_IOC_SUBMIT, &sub) == 0, "Cannot clear\n");
+	misses = attr_read(screen->parent, "stage_cache_misses");
+	spilog_hash_start();
+	CHECK(cdev_write(fctl, "B0", 2, &off) == 2, "Cannot fill black\n");
+	fill_hash = spilog_hash(&fill_nr);
+	CHECK(attr_read(screen->parent, "stage_cache_misses") == misses + 1,
+			"Black fill found in stage cache\n");
+
+	device_attr_store(screen, "rotate", "0");
+	device_attr_store(screen, "mirror", "1");
+	CHECK(cdev_ioctl(fd, EPD_IOC_SUBMIT, &sub) == 0, "Cannot clear\n");
+	misses = attr_read(screen->parent, "stage_cache_misses");
+	spilog_hash_start();
+	sub.data = (uintptr_t)black;
+	CHECK(cdev_ioctl(fd, EPD_IOC_SUBMIT, &sub) == 0,
+			"Cannot draw black\n");
+	hash = spilog_hash(&nr);
+	CHECK(attr_read(screen->parent, "stage_cache_misses") == misses + 1,
+			"Black frame found in stage cache\n");
+	CHECK(fill_nr != 0 && nr == fill_nr && hash == fill_hash,
+			"Black fill differs from encoded black frame\n");
+	device_attr_store(screen, "mirror", "0");
+}
+
+/*
+ * Predictions leave power on and init transfers out, that take less than a
+ * millisecond on virtual clock.
+ */
+#define PREDICT_SLACK_NS NSEC_PER_MSEC
+
+static bool predicted(s64 t, u64 expected)
+{
+	return t >= (s64)expected - PREDICT_SLACK_NS &&
+		t <= (s64)expected + PREDICT_SLACK_NS;
+}
+
+/* Pre-encode an update from old frame to new one, as g1-encode does */
+static size_t encode_update(u8 const *old, u8 const *new, u8 *img)
+{
+	static struct {
+		struct epd_frame f;
+		u8 data[FRAME_SZ];
+	} fold, fnew;
+
+	fold.f.nrline = fnew.f.nrline = FRAME_LINE;
+	fold.f.nrdot = fnew.f.nrdot = FRAME_COL;
+	fold.f.bytes_per_line = fnew.f.bytes_per_line = FRAME_BPL;
+	memcpy(fold.f.data, old, FRAME_SZ);
+	memcpy(fnew.f.data, new, FRAME_SZ);
+
+	if(g1_img_build(G1_TYPE_2_7, &fold.f, &fnew.f, img) < 0)
+		return 0;
+	return g1_img_sz(G1_TYPE_2_7);
+}
+
+/* Concurrent screen users, each one on its own file */
+#define STRESS_WRITERS 2
+#define STRESS_LOOPS 256
+
+struct stress {
+	int fd;
+	unsigned int id;
+	unsigned int ops;
+};
+
+/* Redraw a menu entry without refreshing screen */
+static void *stress_write(void *arg)
+{
+	struct stress *s = arg;
+	struct epd_rect rect = {
+		.x = 3,
+		.y = 40 + s->id * 16,
+		.w = 150,
+		.h = 12,
+	};
+	unsigned int i;
+
+	for(i = 0; i < STRESS_LOOPS; ++i) {
+		rect.color = i & 1;
+		if(cdev_ioctl(s->fd, EPD_IOC_FILL, &rect) == 0)
+			++s->ops;
+	}
+	return NULL;
+}
+
+static void *stress_read(void *arg)
+{
+	static char frame[8192];
+	struct stress *s = arg;
+	unsigned int i;
+	loff_t off;
+
+	for(i = 0; i < STRESS_LOOPS; ++i) {
+		off = 0;
+		if(cdev_read(s->fd, frame, sizeof(frame), &off) > 0)
+			++s->ops;
+	}
+	return NULL;
+}
+
+static void *stress_ctl(void *arg)
+{
+	struct stress *s = arg;
+	loff_t off = 0;
+
+	if(cdev_write(s->fd, "B0", 2, &off) == 2)
+		++s->ops;
+	return NULL;
+}
+
+/* Run writers, a reader and a refresh concurrently, report lock contention */
+static int epd_stress(int fctl)
+{
+	struct stress s[STRESS_WRITERS + 2] = {};
+	pthread_t thread[ARRAY_SIZE(s)];
+	void *(*fn)(void *);
+	char wait[32] = "";
+	unsigned int i, ops = 0;
+	ktime_t start;
+	int ret = 0;
+
+	for(i = 0; i < ARRAY_SIZE(s); ++i) {
+		s[i].id = i;
+		s[i].fd = (i == 0) ? fctl : cdev_open(&epd0);
+		if(s[i].fd < 0) {
+			printk("Cannot open /dev/epd0\n");
+			++failed;
+			ret = -1;
+			goto out;
+		}
+	}
+
+	start = ktime_get();
+	for(i = 0; i < ARRAY_SIZE(s); ++i) {
+		if(i == 0)
+			fn = stress_ctl;
+		else if(i == 1)
+			fn = stress_read;
+		else
+			fn = stress_write;
+		pthread_create(&thread[i], NULL, fn, &s[i]);
+	}
+	for(i = 0; i < ARRAY_SIZE(s); ++i) {
+		pthread_join(thread[i], NULL);
+		ops += s[i].ops;
+	}
+
+	device_attr_show(device_find(epd0.i_rdev), "lock_wait_ns", wait);
+	printk("%u concurrent operations in %lldus, lock wait %s",
+			ops, (long long)ktime_to_us(ktime_sub(ktime_get(), start)),
+			wait);
+	/* Every operation succeeds, whatever the interleaving */
+	CHECK(ops == 1 + (STRESS_WRITERS + 1) * STRESS_LOOPS,
+			"Stress operations failed\n");
+
+out:
+	while(--i > 0)
+		cdev_close(s[i].fd);
+	return ret;
+}
+
+/* Spi log buffer size, for epd_test -o */
+#define SPILOG_SIZE (256 << 20)
+
+/*
+ * Golden spi log of the first update, drawing the blank frame of a cold panel
+ * at 45C, as records count and spilog_hash(). Any change to the power on, init,
+ * encoding or shutdown sequences changes it, "epd_test -o" then spilog-decode
+ * showing the new sequence.
+ */
+#define GOLDEN_NR 1052350
+#define GOLDEN_HASH 0x4ffb65d7c4bdc932ULL
+
+static s64 real_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (s64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Refresh screen frames times, alternating black and clear */
+static void epd_bench(int fctl, unsigned long frames)
+{
+	ktime_t start = ktime_get();
+	s64 rstart = real_us();
+	unsigned long i;
+	loff_t off = 0;
+
+	for(i = 0; i < frames; ++i)
+		CHECK(cdev_write(fctl, (i & 1) ? "C0" : "B0", 2, &off) == 2,
+				"Cannot draw bench frame %lu\n", i);
+
+	printk("%lu frames in %lldus (%lldus virtual)\n", frames,
+			(long long)(real_us() - rstart),
+			(long long)ktime_to_us(ktime_sub(ktime_get(), start)));
+}
+
+int main(int argc, char *argv[])
+{
+	static u8 frame[8192], ref[FRAME_SZ], img[1 << 18];
+	static u8 data[] = {
+		0xff, 0x01, 0x10, 0xaa, 0x55, 0x0f, 0xf0, 0x81, 0x18, 0xc3,
+		0x3c, 0x7e, 0xe7, 0x99, 0x66,
+	};
+	struct epd_blit blit = {
+		.x = 13,
+		.y = 7,
+		.w = 21,
+		.h = 5,
+		.stride = 3,
+		.flags = EPD_RECT_DRAW,
+		.data = (uintptr_t)data,
+	};
+	struct epd_rect rect = {
+		.x = 3,
+		.y = 40,
+		.w = 150,
+		.h = 12,
+		.color = 1,
+	};
+	struct epd_copy copy = {
+		.x = 5,
+		.y = 44,
+		.w = 150,
+		.h = 30,
+		.sx = 3,
+		.sy = 40,
+	};
+	struct epd_submit sub = {
+		.data = (uintptr_t)frame,
+		.len = FRAME_SZ,
+	};
+	struct epd_encoded enc = {
+		.data = (uintptr_t)img,
+	};
+	struct epd_ring_setup setup = {
+		.entries = 2,
+	};
+	struct epd_draw draw = {
+		.flags = EPD_SUBMIT_FORCE | EPD_SUBMIT_DEADLINE,
+		.clock = CLOCK_MONOTONIC,
+	};
+	struct epd_predict predict = {
+		.power = EPD_PREDICT_NOW,
+	};
+	struct epd_ring_hdr *ring;
+	struct epd_ring_sqe *sqe;
+	struct device *screen, *panel;
+	unsigned long long hits, misses, skipped;
+	struct epd_ring_cqe *cqe;
+	loff_t off = 0, foff = 0;
+	char const *log = NULL;
+	char attr[32];
+	ktime_t start;
+	u64 hash, nr;
+	s64 t;
+	unsigned long frames = 0;
+	int ret, fctl, ffb, i;
+
+	for(i = 1; i < argc; ++i) {
+		if(strcmp(argv[i], "-v") == 0) {
+			stub_verbose = true;
+		} else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			log = argv[++i];
+		} else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			frames = strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "Usage: %s [-v] [-o <spi log>] "
+					"[-n <frames>]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	if(log != NULL && spilog_start(SPILOG_SIZE) < 0) {
+		printk("Cannot start spi log\n");
+		return -1;
+	}
 
 	ret = devices_init();
 	if(ret < 0) {
@@ -53,15 +539,205 @@ int main(void)
 		return -1;
 	}
 
+	/* g1 attributes are the screen parent spi device ones */
+	screen = device_find(epd0.i_rdev);
+	panel = screen->parent;
+
 	fctl = cdev_open(&epdctl);
 	if(fctl < 0) {
 		printk("Cannot open /dev/epdctl\n");
 		return -1;
 	}
-	cdev_write(fctl, "W0", 2, &off);
+	spilog_hash_start();
+	CHECK(cdev_write(fctl, "W0", 2, &off) == 2, "Cannot draw frame\n");
+	hash = spilog_hash(&nr);
+	CHECK(nr == GOLDEN_NR && hash == GOLDEN_HASH,
+			"Spi log differs from golden one: %llu records, hash "
+			"%#llx\n", (unsigned long long)nr,
+			(unsigned long long)hash);
+	/* Frame is already displayed, this one should be skipped */
+	skipped = attr_read(screen, "skipped");
+	CHECK(cdev_write(fctl, "W0", 2, &off) == 2, "Cannot skip frame\n");
+	CHECK(attr_read(screen, "skipped") == skipped + 1,
+			"Displayed frame drawn again\n");
+	/* Back to black and white again, the latter should hit stage cache */
+	CHECK(cdev_write(fctl, "B0", 2, &off) == 2, "Cannot draw black\n");
+	hits = attr_read(panel, "stage_cache_hits");
+	CHECK(cdev_write(fctl, "C0", 2, &off) == 2, "Cannot clear\n");
+	CHECK(attr_read(panel, "stage_cache_hits") == hits + 1,
+			"Clear not found in stage cache\n");
+
+	ffb = cdev_open(&epd0);
+	if(ffb < 0) {
+		printk("Cannot open /dev/epd0\n");
+		return -1;
+	}
+	/* Reads stop at frame end, giving frame size */
+	ret = cdev_read(ffb, (char *)frame, sizeof(frame), &foff);
+	CHECK(ret == FRAME_SZ, "Frame size is %d\n", ret);
+	memset(ref, 0, sizeof(ref));
+	frame_check(ffb, 0, ref, "Clear");
+	/* Preload slot 0, right after new frame, with a spliced black frame */
+	memset(frame, 0xff, sizeof(frame));
+	CHECK(cdev_splice(ffb, (char *)frame, FRAME_SZ, &foff) == FRAME_SZ,
+			"Cannot splice slot\n");
+	frame_check(ffb, FRAME_SZ, frame, "Splice");
+	CHECK(cdev_write(fctl, "S0 0", 4, &off) == 4, "Cannot draw slot\n");
+	/* Slot is already displayed, this one should be skipped */
+	skipped = attr_read(screen, "skipped");
+	CHECK(cdev_write(fctl, "S0 0", 4, &off) == 4, "Cannot skip slot\n");
+	CHECK(attr_read(screen, "skipped") == skipped + 1,
+			"Displayed slot drawn again\n");
+
+	/* Draw an unaligned rectangle onto new frame */
+	ret = cdev_ioctl(ffb, EPD_IOC_BLIT, &blit);
+	CHECK(ret == 0, "Cannot blit rectangle\n");
+	ref_blit(ref, &blit, data);
+	frame_check(ffb, 0, ref, "Blit");
+
+	/* Fill a menu entry, scroll it down by overlapping copy, highlight it */
+	ret = cdev_ioctl(ffb, EPD_IOC_FILL, &rect);
+	CHECK(ret == 0, "Cannot fill rectangle\n");
+	ref_fill(ref, &rect);
+	frame_check(ffb, 0, ref, "Fill");
+	ret = cdev_ioctl(ffb, EPD_IOC_COPY, &copy);
+	CHECK(ret == 0, "Cannot copy rectangle\n");
+	ref_copy(ref, &copy);
+	frame_check(ffb, 0, ref, "Copy");
+	rect.flags = EPD_RECT_DRAW;
+	ret = cdev_ioctl(ffb, EPD_IOC_INVERT, &rect);
+	CHECK(ret == 0, "Cannot invert rectangle\n");
+	ref_invert(ref, &rect);
+	frame_check(ffb, 0, ref, "Invert");
+
+	/* Write and draw a blank frame in one call */
+	memset(frame, 0, sizeof(frame));
+	ret = cdev_ioctl(ffb, EPD_IOC_SUBMIT, &sub);
+	CHECK(ret == 0, "Cannot submit frame\n");
+	frame_check(ffb, 0, frame, "Submit");
+
+	/* Queue a blank frame through the submission ring */
+	ret = cdev_ioctl(ffb, EPD_IOC_RING_SETUP, &setup);
+	ring = (ret < 0) ? NULL : cdev_mmap(ffb, setup.size, 0);
+	if(ring != NULL) {
+		sqe = (void *)ring + setup.sq_off;
+		cqe = (void *)ring + setup.cq_off;
+		memset((void *)ring + setup.frames_off, 0, setup.frame_sz);
+		sqe[0].user_data = 42;
+		sqe[0].time_ns = 0;
+		sqe[0].frame = 0;
+		sqe[0].flags = 0;
+		ring->sq_tail = 1;
+		cdev_ioctl(ffb, EPD_IOC_RING_KICK, NULL);
+		flush_workqueue(system_long_wq);
+	}
+	CHECK(ring != NULL && ring->cq_tail == 1 && cqe[0].user_data == 42 &&
+			cqe[0].res == 0, "Cannot queue ring frame\n");
+	memset(frame, 0, sizeof(frame));
+	frame_check(ffb, 0, frame, "Ring");
+
+	/* Redraw it, taking as long as predicted on virtual clock */
+	ret = cdev_ioctl(ffb, EPD_IOC_PREDICT, &predict);
+	CHECK(ret == 0, "Cannot predict update\n");
+	start = ktime_get();
+	CHECK(cdev_write(fctl, "F0", 2, &off) == 2, "Cannot force draw\n");
+	t = ktime_to_ns(ktime_sub(ktime_get(), start));
+	CHECK(predicted(t, predict.duration_ns),
+			"Update took %lldns, %lluns predicted\n", (long long)t,
+			(unsigned long long)predict.duration_ns);
+
+	/* Refresh screen 1ms after predicted to be possible */
+	ret = cdev_ioctl(ffb, EPD_IOC_PREDICT, &predict);
+	CHECK(ret == 0, "Cannot predict update\n");
+	draw.deadline_ns = ktime_get_ns() + predict.shown_ns + NSEC_PER_MSEC;
+	ret = cdev_ioctl(ffb, EPD_IOC_DRAW, &draw);
+	CHECK(ret == 0, "Cannot draw at deadline\n");
+	/* On virtual clock, frame shows exactly at deadline */
+	CHECK(device_attr_show(device_find(epd0.i_rdev), "deadline_latency_ns",
+				attr) >= 0 && strtoll(attr, NULL, 10) == 0,
+			"Deadline missed by %s", attr);
+	/* Then update ends as long after deadline as predicted */
+	t = ktime_get_ns() - draw.deadline_ns;
+	CHECK(predicted(t, predict.duration_ns - predict.shown_ns),
+			"Update ended %lldns after deadline, %lluns predicted\n",
+			(long long)t, (unsigned long long)
+			(predict.duration_ns - predict.shown_ns));
+
+	/* Draw a checkerboard pre-encoded over the displayed blank frame */
+	for(i = 0; i < FRAME_SZ; ++i)
+		ref[i] = ((i / FRAME_BPL) & 1) ? 0x55 : 0xaa;
+	enc.len = encode_update(frame, ref, img);
+	ret = cdev_ioctl(ffb, EPD_IOC_DRAW_ENCODED, &enc);
+	CHECK(ret == 0, "Cannot draw encoded update\n");
+	frame_check(ffb, 0, ref, "Encoded");
+	/* Displayed frame is not the blank one anymore */
+	ret = cdev_ioctl(ffb, EPD_IOC_DRAW_ENCODED, &enc);
+	CHECK(ret == -ESTALE, "Stale encoded update drawn\n");
+	/* Pre-encoded stages are not cached, the same update gets encoded */
+	hits = attr_read(panel, "stage_cache_hits");
+	misses = attr_read(panel, "stage_cache_misses");
+	CHECK(cdev_ioctl(ffb, EPD_IOC_SUBMIT, &sub) == 0,
+			"Cannot submit frame\n");
+	memcpy(frame, ref, FRAME_SZ);
+	CHECK(cdev_ioctl(ffb, EPD_IOC_SUBMIT, &sub) == 0,
+			"Cannot submit frame\n");
+	frame_check(ffb, 0, ref, "Encoded again");
+	CHECK(attr_read(panel, "stage_cache_hits") == hits &&
+			attr_read(panel, "stage_cache_misses") == misses + 2,
+			"Pre-encoded stages found in stage cache\n");
+
+	/*
+	 * Panel mounted upside down, frame is flipped by the encoder, the user
+	 * frame staying as is.
+	 */
+	CHECK(device_attr_store(device_find(epd0.i_rdev), "rotate", "180") >= 0,
+			"Cannot rotate\n");
+	frame_check(ffb, 0, ref, "Rotate");
+	CHECK(cdev_write(fctl, "W0", 2, &off) == 2, "Cannot draw rotated\n");
+	frame_check(ffb, 0, ref, "Rotated draw");
+
+	/*
+	 * Panel gets a rotated, mirrored or inverted frame as it would the
+	 * reference one, user frame being asymmetric so that any wrong flip
+	 * shows.
+	 */
+	for(i = 0; i < FRAME_SZ; ++i)
+		frame[i] = (i * 7 + i / 5) ^ (i >> 4);
+	ref_orient(ref, frame, 90, false, false);
+	orient_check(ffb, "rotate", "90", frame, ref);
+	ref_orient(ref, frame, 180, false, false);
+	orient_check(ffb, "rotate", "180", frame, ref);
+	ref_orient(ref, frame, 270, false, false);
+	orient_check(ffb, "rotate", "270", frame, ref);
+	ref_orient(ref, frame, 0, true, false);
+	orient_check(ffb, "mirror", "1", frame, ref);
+	ref_orient(ref, frame, 0, false, true);
+	orient_check(ffb, "invert", "1", frame, ref);
+	device_attr_store(device_find(epd0.i_rdev), "invert", "0");
+	fill_check(ffb, fctl);
+
+	/* Updates above are accounted until statistics are reset */
+	CHECK(device_attr_show(device_find(epd0.i_rdev), "updates", attr) >= 0 &&
+			strtoull(attr, NULL, 10) != 0, "Updates not accounted\n");
+	device_attr_store(device_find(epd0.i_rdev), "reset", "1");
+	cdev_close(ffb);
+
+	epd_stress(fctl);
+	if(frames != 0)
+		epd_bench(fctl, frames);
 
 	cdev_close(fctl);
 
 	devices_exit();
+
+	if(log != NULL && spilog_dump(log) < 0) {
+		printk("Cannot dump spi log to %s\n", log);
+		return -1;
+	}
+
+	if(failed != 0) {
+		printk("%u checks failed\n", failed);
+		return 1;
+	}
 	return 0;
 }
@@ -1,6 +1,9 @@
 #include <linux/module.h>
 #include <linux/gpio.h>
 
+#include <vclock.h>
+#include <spilog.h>
+
 #define GPIO_MAX 256
 
 static int gpio_val[GPIO_MAX] = {};
@@ -13,7 +16,10 @@ int gpio_get_value(unsigned int gpio)
 		return 0;
 	}
 
-	printf("Get GPIO Value %u with %d\n", gpio, gpio_val[gpio]);
+	vclock_advance(VCLOCK_GPIO_NS);
+	spilog_add(SPILOG_GPIO_GET, 0, gpio, NULL, gpio_val[gpio]);
+	if(stub_verbose)
+		printf("Get GPIO Value %u with %d\n", gpio, gpio_val[gpio]);
 	return gpio_val[gpio];
 }
 
@@ -22,6 +28,9 @@ void gpio_set_value(unsigned int gpio, int value)
 	if(gpio >= GPIO_MAX)
 		printk("Invalid GPIO\n");
 
-	printf("Set GPIO Value %u with %d\n", gpio, value);
+	vclock_advance(VCLOCK_GPIO_NS);
+	spilog_add(SPILOG_GPIO_SET, 0, gpio, NULL, value);
+	if(stub_verbose)
+		printf("Set GPIO Value %u with %d\n", gpio, value);
 	gpio_val[gpio] = value;
 }
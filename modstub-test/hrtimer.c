@@ -0,0 +1,103 @@
+#include <pthread.h>
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/hrtimer.h>
+
+#include <vclock.h>
+
+struct hrtimer_thread {
+	struct hrtimer *timer;
+	unsigned int gen;
+};
+
+/* Sleep until expiry, then run callback if timer is still this generation */
+static void *hrtimer_thread(void *arg)
+{
+	struct hrtimer_thread *t = arg;
+	struct hrtimer *timer = t->timer;
+	enum hrtimer_restart restart;
+
+	pthread_mutex_lock(&vclock_lock);
+	while(timer->gen == t->gen) {
+		if(ktime_before(ktime_get(), timer->expires)) {
+			vclock_wait(timer->expires);
+			continue;
+		}
+
+		timer->running = true;
+		pthread_mutex_unlock(&vclock_lock);
+		restart = timer->function(timer);
+		pthread_mutex_lock(&vclock_lock);
+		timer->running = false;
+		pthread_cond_broadcast(&vclock_cond);
+		if(restart == HRTIMER_NORESTART && timer->gen == t->gen)
+			timer->active = false;
+		if(!timer->active)
+			break;
+	}
+	pthread_mutex_unlock(&vclock_lock);
+	kfree(t);
+	return NULL;
+}
+
+void hrtimer_init(struct hrtimer *timer, clockid_t clock_id,
+		enum hrtimer_mode mode)
+{
+	timer->function = NULL;
+	timer->expires = 0;
+	timer->gen = 0;
+	timer->active = false;
+	timer->running = false;
+}
+
+void hrtimer_start(struct hrtimer *timer, ktime_t tim,
+		enum hrtimer_mode const mode)
+{
+	struct hrtimer_thread *t;
+	pthread_t thread;
+
+	t = kmalloc(sizeof(*t), GFP_KERNEL);
+	if(t == NULL)
+		return;
+
+	pthread_mutex_lock(&vclock_lock);
+	if(mode == HRTIMER_MODE_REL)
+		tim = ktime_add(ktime_get(), tim);
+	timer->expires = tim;
+	t->timer = timer;
+	t->gen = ++timer->gen;
+	timer->active = true;
+	if(pthread_create(&thread, NULL, hrtimer_thread, t) != 0) {
+		printk("Cannot start hrtimer\n");
+		kfree(t);
+	} else {
+		pthread_detach(thread);
+	}
+	pthread_mutex_unlock(&vclock_lock);
+}
+
+/* Return 1 if timer was active, wait for a running callback to finish */
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	int ret;
+
+	pthread_mutex_lock(&vclock_lock);
+	ret = timer->active || timer->running;
+	timer->active = false;
+	++timer->gen;
+	while(timer->running)
+		pthread_cond_wait(&vclock_cond, &vclock_lock);
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool hrtimer_active(struct hrtimer *timer)
+{
+	bool ret;
+
+	pthread_mutex_lock(&vclock_lock);
+	ret = timer->active || timer->running;
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
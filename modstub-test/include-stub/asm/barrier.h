@@ -0,0 +1,7 @@
+#ifndef _ASM_STUB_BARRIER_H_
+#define _ASM_STUB_BARRIER_H_
+
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef _ASM_STUB_BYTEORDER_H_
+#define _ASM_STUB_BYTEORDER_H_
+
+#include <endian.h>
+
+#define le32_to_cpu(x) le32toh(x)
+#define le64_to_cpu(x) le64toh(x)
+#define cpu_to_le32(x) htole32(x)
+#define cpu_to_le64(x) htole64(x)
+
+#endif
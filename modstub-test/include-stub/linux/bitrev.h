@@ -0,0 +1,14 @@
+#ifndef _LINUX_STUB_BITREV_H_
+#define _LINUX_STUB_BITREV_H_
+
+#include <linux/types.h>
+
+static inline u8 bitrev8(u8 b)
+{
+	b = (b >> 4) | (b << 4);
+	b = ((b >> 2) & 0x33) | ((b & 0x33) << 2);
+	b = ((b >> 1) & 0x55) | ((b & 0x55) << 1);
+	return b;
+}
+
+#endif
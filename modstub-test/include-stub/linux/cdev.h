@@ -16,7 +16,10 @@ int cdev_add(struct cdev *p, dev_t dev, unsigned count);
 void cdev_del(struct cdev *p);
 int cdev_open(struct inode *i);
 int cdev_write(int fd, char const *buf, size_t len, loff_t *off);
+int cdev_splice(int fd, char const *buf, size_t len, loff_t *off);
 int cdev_read(int fd, char *buf, size_t len, loff_t *off);
+long cdev_ioctl(int fd, unsigned int cmd, void *arg);
+void *cdev_mmap(int fd, size_t len, loff_t off);
 void cdev_close(int fd);
 
 #endif
@@ -10,8 +10,8 @@
 
 #define __must_be_array(a) 0
 
-#define WRITE_ONCE(x, val) (x = val)
-#define READ_ONCE(x) (x)
+#define WRITE_ONCE(x, val) __atomic_store_n(&(x), val, __ATOMIC_RELAXED)
+#define READ_ONCE(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
 #define __user
 #define typeof __typeof__
 
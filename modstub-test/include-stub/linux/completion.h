@@ -0,0 +1,79 @@
+#ifndef _LINUX_STUB_COMPLETION_H_
+#define _LINUX_STUB_COMPLETION_H_
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/jiffies.h>
+
+#include <vclock.h>
+
+/* Waiters sleep on vclock_cond, so that timeouts are on virtual clock */
+struct completion {
+	unsigned int done;
+};
+
+#define COMPLETION_INITIALIZER(work) { .done = 0 }
+
+#define DECLARE_COMPLETION(work)					\
+	struct completion work = COMPLETION_INITIALIZER(work)
+
+static inline void init_completion(struct completion *x)
+{
+	x->done = 0;
+}
+
+static inline void reinit_completion(struct completion *x)
+{
+	pthread_mutex_lock(&vclock_lock);
+	x->done = 0;
+	pthread_mutex_unlock(&vclock_lock);
+}
+
+static inline void complete(struct completion *x)
+{
+	pthread_mutex_lock(&vclock_lock);
+	if(x->done != UINT_MAX)
+		++x->done;
+	pthread_cond_broadcast(&vclock_cond);
+	pthread_mutex_unlock(&vclock_lock);
+}
+
+static inline void complete_all(struct completion *x)
+{
+	pthread_mutex_lock(&vclock_lock);
+	x->done = UINT_MAX;
+	pthread_cond_broadcast(&vclock_cond);
+	pthread_mutex_unlock(&vclock_lock);
+}
+
+static inline void wait_for_completion(struct completion *x)
+{
+	pthread_mutex_lock(&vclock_lock);
+	while(x->done == 0)
+		pthread_cond_wait(&vclock_cond, &vclock_lock);
+	if(x->done != UINT_MAX)
+		--x->done;
+	pthread_mutex_unlock(&vclock_lock);
+}
+
+/* Return 0 on timeout, remaining jiffies (at least 1) otherwise */
+static inline unsigned long wait_for_completion_timeout(struct completion *x,
+		unsigned long timeout)
+{
+	u64 end = jiffies + timeout, now;
+	unsigned long ret = 0;
+
+	pthread_mutex_lock(&vclock_lock);
+	while(x->done == 0 && (now = jiffies) < end)
+		vclock_wait((u64)end * 1000);
+	if(x->done != 0) {
+		if(x->done != UINT_MAX)
+			--x->done;
+		now = jiffies;
+		ret = (now < end) ? end - now : 1;
+	}
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _LINUX_STUB_DEBUGFS_H_
+#define _LINUX_STUB_DEBUGFS_H_
+
+#include <linux/types.h>
+#include <linux/fs.h>
+
+/* No debugfs in stubs, entries are never created */
+struct dentry;
+
+static inline struct dentry *debugfs_create_dir(char const *name,
+		struct dentry *parent)
+{
+	(void)name;
+	(void)parent;
+	return NULL;
+}
+
+static inline struct dentry *debugfs_create_file(char const *name,
+		umode_t mode, struct dentry *parent, void *data,
+		struct file_operations const *fops)
+{
+	(void)name;
+	(void)mode;
+	(void)parent;
+	(void)data;
+	(void)fops;
+	return NULL;
+}
+
+static inline void debugfs_remove_recursive(struct dentry *dentry)
+{
+	(void)dentry;
+}
+
+#endif
@@ -1,8 +1,8 @@
 #ifndef _LINUX_STUB_DELAY_H_
 #define _LINUX_STUB_DELAY_H_
 
-#include <unistd.h>
+#include <vclock.h>
 
-#define mdelay(n) usleep(n * 1000)
+#define mdelay(n) vclock_advance((u64)(n) * 1000000)
 
 #endif
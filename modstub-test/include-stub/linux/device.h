@@ -4,6 +4,8 @@
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/kdev_t.h>
+#include <linux/sysfs.h>
+#include <linux/pm.h>
 
 struct class {
 	const char *name;
@@ -12,6 +14,8 @@ struct class {
 
 struct device {
 	struct list_head	next;
+	struct device		*parent;
+	struct kobject		kobj;
 	void			*platform_data;
 	void			*driver_data;
 	char const *name;
@@ -25,6 +29,7 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	const struct of_device_id	*of_match_table;
+	const struct dev_pm_ops *pm;
 
 	int (*probe) (struct device *dev);
 	int (*remove) (struct device *dev);
@@ -32,6 +37,36 @@ struct device_driver {
 	int (*resume) (struct device *dev);
 };
 
+struct device_attribute {
+	struct attribute	attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr,
+			char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count);
+};
+
+#define DEVICE_ATTR(_name, _mode, _show, _store) \
+	struct device_attribute dev_attr_##_name = __ATTR(_name, _mode, _show, _store)
+#define DEVICE_ATTR_RW(_name) \
+	struct device_attribute dev_attr_##_name = __ATTR_RW(_name)
+#define DEVICE_ATTR_RO(_name) \
+	struct device_attribute dev_attr_##_name = __ATTR_RO(_name)
+#define DEVICE_ATTR_WO(_name) \
+	struct device_attribute dev_attr_##_name = __ATTR_WO(_name)
+
+#define kobj_to_dev(k) container_of(k, struct device, kobj)
+
+/* Test helpers: find a created device, read/write a device sysfs attribute */
+struct device *device_find(dev_t devt);
+ssize_t device_attr_show(struct device *dev, char const *name, char *buf);
+ssize_t device_attr_store(struct device *dev, char const *name,
+		char const *buf);
+
+static inline char const *dev_name(const struct device *dev)
+{
+	return dev->name;
+}
+
 static inline void *dev_get_platdata(const struct device *dev)
 {
 	return dev->platform_data;
@@ -50,6 +85,10 @@ static inline void dev_set_drvdata(struct device *dev, void *data)
 struct device *device_create(struct class *class, struct device *parent,
 		dev_t devt, void *drvdata, const char *fmt, ...);
 
+struct device *device_create_with_groups(struct class *class,
+		struct device *parent, dev_t devt, void *drvdata,
+		struct attribute_group const **groups, const char *fmt, ...);
+
 void device_destroy(struct class *class, dev_t devt);
 
 static inline struct class *class_create(struct module *owner,
@@ -3,10 +3,10 @@
 
 #include <errno.h>
 #include <linux/compiler.h>
+#include <linux/types.h>
 
 #define __must_check
 #define __force
-#define bool uint8_t
 
 #define MAX_ERRNO 4095
 
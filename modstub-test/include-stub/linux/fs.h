@@ -5,13 +5,22 @@
 #include <linux/kdev_t.h>
 #include <linux/compiler.h>
 #include <linux/list.h>
+#include <linux/uio.h>
 #include <unistd.h>
 #include <errno.h>
 
 struct file;
+struct pipe_inode_info;
+struct vm_area_struct;
+
+struct kiocb {
+	struct file *ki_filp;
+	loff_t ki_pos;
+};
 
 struct inode {
 	dev_t i_rdev;
+	void *i_private;
 };
 
 struct file_operations {
@@ -19,8 +28,13 @@ struct file_operations {
 	loff_t (*llseek)(struct file *, loff_t, int);
 	ssize_t (*read)(struct file *, char __user *, size_t, loff_t *);
 	ssize_t (*write)(struct file *, char const __user *, size_t, loff_t *);
+	ssize_t (*write_iter)(struct kiocb *, struct iov_iter *);
+	ssize_t (*splice_write)(struct pipe_inode_info *, struct file *,
+			loff_t *, size_t, unsigned int);
 	int (*open)(struct inode *, struct file *);
 	int (*release)(struct inode *, struct file *);
+	long (*unlocked_ioctl)(struct file *, unsigned int, unsigned long);
+	int (*mmap)(struct file *, struct vm_area_struct *);
 };
 
 struct file {
@@ -61,6 +75,12 @@ static inline int nonseekable_open(struct inode *i, struct file *f)
 	return 0;
 }
 
+static inline int simple_open(struct inode *i, struct file *f)
+{
+	f->private_data = i->i_private;
+	return 0;
+}
+
 static inline unsigned iminor(struct inode const *inode)
 {
         return MINOR(inode->i_rdev);
@@ -81,5 +101,7 @@ static inline unsigned imajor(struct inode const *inode)
 int alloc_chrdev_region(dev_t *dev, unsigned baseminor, unsigned count,
 		char const *name);
 void unregister_chrdev_region(dev_t from, unsigned count);
+ssize_t iter_file_splice_write(struct pipe_inode_info *pipe, struct file *out,
+		loff_t *ppos, size_t len, unsigned int flags);
 
 #endif
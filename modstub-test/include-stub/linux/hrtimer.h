@@ -0,0 +1,54 @@
+#ifndef _LINUX_STUB_HRTIMER_H_
+#define _LINUX_STUB_HRTIMER_H_
+
+#include <time.h>
+#include <linux/ktime.h>
+
+enum hrtimer_mode {
+	HRTIMER_MODE_ABS = 0x0,
+	HRTIMER_MODE_REL = 0x1,
+};
+
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+
+/*
+ * Each started timer expires from its own thread on virtual clock, a
+ * timer being (re)started or canceled bumps its generation so that an older
+ * thread does not run its callback (see hrtimer.c).
+ */
+struct hrtimer {
+	enum hrtimer_restart (*function)(struct hrtimer *timer);
+	ktime_t expires;
+	unsigned int gen;
+	bool active;
+	bool running;
+};
+
+void hrtimer_init(struct hrtimer *timer, clockid_t clock_id,
+		enum hrtimer_mode mode);
+void hrtimer_start(struct hrtimer *timer, ktime_t tim,
+		enum hrtimer_mode const mode);
+int hrtimer_cancel(struct hrtimer *timer);
+bool hrtimer_active(struct hrtimer *timer);
+
+static inline void hrtimer_forward_now(struct hrtimer *timer,
+		ktime_t interval)
+{
+	timer->expires = ktime_add(ktime_get(), interval);
+}
+
+static inline int schedule_hrtimeout_range(ktime_t *expires, u64 delta,
+		enum hrtimer_mode const mode)
+{
+	(void)delta;
+	if(mode == HRTIMER_MODE_ABS)
+		vclock_sleep_until(*expires);
+	else
+		vclock_advance(*expires);
+	return 0;
+}
+
+#endif
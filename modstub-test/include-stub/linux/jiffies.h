@@ -1,22 +1,20 @@
 #ifndef _LINUX_STUB_JIFFIES_H_
 #define _LINUX_STUB_JIFFIES_H_
 
-#include <sys/time.h>
-
 #include <linux/typecheck.h>
 
+#include <vclock.h>
+
 #define jiffies get_jiffies()
 
 #define msecs_to_jiffies(m) (m * 1000)
 #define usecs_to_jiffies(u) (u)
+#define nsecs_to_jiffies(n) ((n) / 1000)
 
+/* One jiffy per virtual us */
 static inline u64 get_jiffies(void)
 {
-	struct timeval tv;
-
-	gettimeofday(&tv, NULL);
-
-	return tv.tv_sec * 1000000 + tv.tv_usec;
+	return vclock_now() / 1000;
 }
 
 
@@ -3,9 +3,17 @@
 
 #include <linux/compiler.h>
 #include <linux/stddef.h>
+#include <linux/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]) + __must_be_array(arr))
 
+#define U16_MAX ((u16)~0U)
+#define UINT_MAX (~0U)
+
 #define min(x, y) ({                            \
         typeof(x) _min1 = (x);                  \
         typeof(y) _min2 = (y);                  \
@@ -34,6 +42,85 @@
         type __max2 = (y);                      \
         __max1 > __max2 ? __max1: __max2; })
 
+#define clamp(val, lo, hi) min(max(val, lo), hi)
+#define clamp_t(type, val, lo, hi) min_t(type, max_t(type, val, lo), hi)
+
+static inline int __kstrto_end(char const *s, char const *end)
+{
+	if(end == s)
+		return -EINVAL;
+	if(*end == '\n')
+		++end;
+	return (*end == '\0') ? 0 : -EINVAL;
+}
+
+static inline int kstrtoul(char const *s, unsigned int base,
+		unsigned long *res)
+{
+	char *end;
+
+	errno = 0;
+	*res = strtoul(s, &end, base);
+	if(errno)
+		return -ERANGE;
+	return __kstrto_end(s, end);
+}
+
+static inline int kstrtoint(char const *s, unsigned int base, int *res)
+{
+	char *end;
+
+	errno = 0;
+	*res = strtol(s, &end, base);
+	if(errno)
+		return -ERANGE;
+	return __kstrto_end(s, end);
+}
+
+static inline int kstrtouint(char const *s, unsigned int base,
+		unsigned int *res)
+{
+	unsigned long v;
+	int ret;
+
+	ret = kstrtoul(s, base, &v);
+	if(ret == 0)
+		*res = v;
+	return ret;
+}
+
+static inline int kstrtobool(char const *s, bool *res)
+{
+	if(s == NULL)
+		return -EINVAL;
+
+	switch(s[0]) {
+	case 'y': case 'Y': case '1':
+		*res = true;
+		return 0;
+	case 'n': case 'N': case '0':
+		*res = false;
+		return 0;
+	}
+	return -EINVAL;
+}
+
+static inline int scnprintf(char *buf, size_t size, char const *fmt, ...)
+{
+	va_list args;
+	int i;
+
+	va_start(args, fmt);
+	i = vsnprintf(buf, size, fmt, args);
+	va_end(args);
+
+	if(i < 0)
+		return 0;
+	if((size_t)i >= size)
+		return size ? size - 1 : 0;
+	return i;
+}
+
 /**
  * container_of - cast a member of a structure out to the containing structure
  * @ptr:        the pointer to the member.
@@ -45,4 +132,17 @@
         const typeof( ((type *)0)->member ) *__mptr = (ptr);    \
         (type *)( (char *)__mptr - offsetof(type,member) );})
 
+#define swap(a, b) do {						\
+		typeof(a) __tmp = (a);					\
+		(a) = (b);						\
+		(b) = __tmp;						\
+} while(0)
+
+#define ALIGN(x, a) (((x) + ((typeof(x))(a) - 1)) & ~((typeof(x))(a) - 1))
+#define IS_ALIGNED(x, a) (((x) & ((typeof(x))(a) - 1)) == 0)
+
+#define u64_to_user_ptr(x) ((void __user *)(uintptr_t)(x))
+
+#define DIV_ROUND_UP(a, b) (((a) + (b) - 1) / (b))
+
 #endif
@@ -0,0 +1,32 @@
+#ifndef _LINUX_STUB_KTHREAD_H_
+#define _LINUX_STUB_KTHREAD_H_
+
+#include <pthread.h>
+
+#include <linux/types.h>
+#include <linux/err.h>
+
+/* Each kthread is a pthread, started on creation (see kthread.c) */
+struct task_struct {
+	pthread_t thread;
+	int (*threadfn)(void *data);
+	void *data;
+	bool should_stop;
+	int ret;
+	char comm[16];
+};
+
+struct task_struct *kthread_create(int (*threadfn)(void *data), void *data,
+		char const *namefmt, ...);
+int kthread_stop(struct task_struct *k);
+bool kthread_should_stop(void);
+
+static inline int wake_up_process(struct task_struct *p)
+{
+	return 1;
+}
+
+#define kthread_run(threadfn, data, namefmt, ...)			\
+	kthread_create(threadfn, data, namefmt, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _LINUX_STUB_KTIME_H_
+#define _LINUX_STUB_KTIME_H_
+
+#include <time.h>
+
+#include <linux/types.h>
+
+#include <vclock.h>
+
+#define NSEC_PER_USEC	1000L
+#define NSEC_PER_MSEC	1000000L
+#define NSEC_PER_SEC	1000000000L
+
+typedef s64 ktime_t;
+
+/* Both clocks are virtual, see vclock.h */
+static inline ktime_t ktime_get(void)
+{
+	return vclock_now();
+}
+
+static inline ktime_t ktime_get_real(void)
+{
+	return vclock_now() + VCLOCK_REAL_OFFSET_NS;
+}
+
+static inline u64 ktime_get_ns(void)
+{
+	return ktime_get();
+}
+
+#define ktime_add(a, b)		((a) + (b))
+#define ktime_sub(a, b)		((a) - (b))
+#define ktime_add_ns(kt, ns)	((kt) + (ns))
+#define ktime_add_us(kt, us)	((kt) + (s64)(us) * NSEC_PER_USEC)
+#define ktime_add_ms(kt, ms)	((kt) + (s64)(ms) * NSEC_PER_MSEC)
+#define ktime_to_ns(kt)		((s64)(kt))
+#define ktime_to_us(kt)		((s64)(kt) / NSEC_PER_USEC)
+#define ktime_to_ms(kt)		((s64)(kt) / NSEC_PER_MSEC)
+#define ns_to_ktime(ns)		((ktime_t)(ns))
+#define ms_to_ktime(ms)		((ktime_t)(ms) * NSEC_PER_MSEC)
+
+static inline int ktime_compare(ktime_t const cmp1, ktime_t const cmp2)
+{
+	if(cmp1 < cmp2)
+		return -1;
+	if(cmp1 > cmp2)
+		return 1;
+	return 0;
+}
+
+static inline bool ktime_after(ktime_t const cmp1, ktime_t const cmp2)
+{
+	return ktime_compare(cmp1, cmp2) > 0;
+}
+
+static inline bool ktime_before(ktime_t const cmp1, ktime_t const cmp2)
+{
+	return ktime_compare(cmp1, cmp2) < 0;
+}
+
+static inline s64 ktime_us_delta(ktime_t const later, ktime_t const earlier)
+{
+	return ktime_to_us(ktime_sub(later, earlier));
+}
+
+#endif
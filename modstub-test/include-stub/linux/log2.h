@@ -0,0 +1,14 @@
+#ifndef _LINUX_STUB_LOG2_H_
+#define _LINUX_STUB_LOG2_H_
+
+#include <linux/types.h>
+
+static inline bool is_power_of_2(unsigned long n)
+{
+	return (n != 0 && ((n & (n - 1)) == 0));
+}
+
+#define rounddown_pow_of_two(n) (1UL << ilog2(n))
+#define ilog2(n) (63 - __builtin_clzll((unsigned long long)(n)))
+
+#endif
@@ -1,8 +1,8 @@
 #ifndef _LINUX_STUB_MISC_H_
 #define _LINUX_STUB_MISC_H_
 
-#include <sched.h>
+#include <vclock.h>
 
-#define cpu_relax sched_yield
+#define cpu_relax() vclock_advance(VCLOCK_RELAX_NS)
 
 #endif
@@ -0,0 +1,17 @@
+#ifndef _LINUX_STUB_MM_H_
+#define _LINUX_STUB_MM_H_
+
+#include <linux/kernel.h>
+
+#ifndef PAGE_SIZE
+#define PAGE_SIZE 4096
+#endif
+#define PAGE_ALIGN(addr) ALIGN(addr, PAGE_SIZE)
+
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_pgoff;
+};
+
+#endif
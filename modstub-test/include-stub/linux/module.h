@@ -14,11 +14,10 @@
 #include <linux/jiffies.h>
 #include <linux/export.h>
 #include <linux/init.h>
+#include <linux/moduleparam.h>
 
 #include <linux/misc.h>
 
-#define DIV_ROUND_UP(a, b) (((a) + (b) - 1) / b)
-
 #define MODULE_AUTHOR(author)
 #define MODULE_DESCRIPTION(desc)
 #define MODULE_LICENSE(license)
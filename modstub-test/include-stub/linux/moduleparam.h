@@ -0,0 +1,7 @@
+#ifndef _LINUX_STUB_MODULEPARAM_H_
+#define _LINUX_STUB_MODULEPARAM_H_
+
+#define module_param(name, type, perm)
+#define MODULE_PARM_DESC(_parm, desc)
+
+#endif
@@ -1,31 +1,32 @@
 #ifndef _LINUX_STUB_MUTEX_H_
 #define _LINUX_STUB_MUTEX_H_
 
-#include <sched.h>
+#include <pthread.h>
 
 struct mutex {
-	char locked;
+	pthread_mutex_t lock;
 };
 
-#define DEFINE_MUTEX(m) struct mutex m = {.locked = 0}
+#define DEFINE_MUTEX(m) struct mutex m = {.lock = PTHREAD_MUTEX_INITIALIZER}
 
 static inline void mutex_init(struct mutex *lock)
 {
-	lock->locked = 0;
+	pthread_mutex_init(&lock->lock, NULL);
 }
 
 static inline void mutex_lock(struct mutex *lock)
 {
-	/* XXX Not thread safe, but ok for stub */
-	while(lock->locked)
-		sched_yield();
-	lock->locked = 1;
+	pthread_mutex_lock(&lock->lock);
+}
+
+static inline int mutex_trylock(struct mutex *lock)
+{
+	return pthread_mutex_trylock(&lock->lock) == 0;
 }
 
 static inline void mutex_unlock(struct mutex *lock)
 {
-	/* XXX Not thread safe, but ok for stub */
-	lock->locked = 0;
+	pthread_mutex_unlock(&lock->lock);
 }
 
 #endif
@@ -0,0 +1,6 @@
+#ifndef _LINUX_STUB_OVERFLOW_H_
+#define _LINUX_STUB_OVERFLOW_H_
+
+#define check_mul_overflow(a, b, d) __builtin_mul_overflow(a, b, d)
+
+#endif
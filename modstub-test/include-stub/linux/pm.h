@@ -0,0 +1,24 @@
+#ifndef _LINUX_STUB_PM_H_
+#define _LINUX_STUB_PM_H_
+
+struct device;
+
+struct dev_pm_ops {
+	int (*suspend)(struct device *dev);
+	int (*resume)(struct device *dev);
+};
+
+#ifdef CONFIG_PM_SLEEP
+#define SET_SYSTEM_SLEEP_PM_OPS(suspend_fn, resume_fn)			\
+	.suspend = suspend_fn,						\
+	.resume = resume_fn,
+#else
+#define SET_SYSTEM_SLEEP_PM_OPS(suspend_fn, resume_fn)
+#endif
+
+#define SIMPLE_DEV_PM_OPS(name, suspend_fn, resume_fn)			\
+	struct dev_pm_ops const name = {				\
+		SET_SYSTEM_SLEEP_PM_OPS(suspend_fn, resume_fn)		\
+	}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef _LINUX_STUB_SCHED_H_
+#define _LINUX_STUB_SCHED_H_
+
+#define TASK_RUNNING 0x0
+#define TASK_INTERRUPTIBLE 0x1
+#define TASK_UNINTERRUPTIBLE 0x2
+
+struct task_struct;
+
+#define current ((struct task_struct *)NULL)
+
+#define set_current_state(state) do { } while(0)
+
+#endif
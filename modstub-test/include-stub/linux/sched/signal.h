@@ -0,0 +1,12 @@
+#ifndef _LINUX_STUB_SCHED_SIGNAL_H_
+#define _LINUX_STUB_SCHED_SIGNAL_H_
+
+#include <linux/sched.h>
+
+/* No signal is ever delivered to stub threads */
+static inline int signal_pending(struct task_struct *p)
+{
+	return 0;
+}
+
+#endif
@@ -5,6 +5,7 @@
 
 #define kmalloc(s, f) malloc(s)
 #define kzalloc(s, f) calloc(1, s)
+#define kcalloc(n, s, f) calloc(n, s)
 #define kfree(p) free((void *)p)
 
 #endif
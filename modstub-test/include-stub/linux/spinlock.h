@@ -0,0 +1,25 @@
+#ifndef _LINUX_STUB_SPINLOCK_H_
+#define _LINUX_STUB_SPINLOCK_H_
+
+#include <pthread.h>
+
+typedef struct {
+	pthread_spinlock_t lock;
+} spinlock_t;
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+	pthread_spin_init(&lock->lock, PTHREAD_PROCESS_PRIVATE);
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+	pthread_spin_lock(&lock->lock);
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+	pthread_spin_unlock(&lock->lock);
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _LINUX_STUB_STRING_H_
+#define _LINUX_STUB_STRING_H_
+
+#include <string.h>
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef _LINUX_STUB_SYSFS_H_
+#define _LINUX_STUB_SYSFS_H_
+
+#include <linux/types.h>
+#include <linux/list.h>
+
+#ifndef PAGE_SIZE
+#define PAGE_SIZE 4096
+#endif
+
+#define SYSFS_GROUPS_MAX 8
+
+struct attribute {
+	const char		*name;
+	umode_t			mode;
+};
+
+struct attribute_group {
+	const char		*name;
+	struct attribute	**attrs;
+};
+
+struct kobject {
+	struct attribute_group const *groups[SYSFS_GROUPS_MAX];
+};
+
+#define __ATTR(_name, _mode, _show, _store) {				\
+	.attr = {.name = #_name, .mode = _mode },			\
+	.show	= _show,						\
+	.store	= _store,						\
+}
+
+#define __ATTR_RW(_name) __ATTR(_name, 0644, _name##_show, _name##_store)
+#define __ATTR_RO(_name) __ATTR(_name, 0444, _name##_show, NULL)
+#define __ATTR_WO(_name) __ATTR(_name, 0200, NULL, _name##_store)
+
+#define ATTRIBUTE_GROUPS(_name)						\
+static struct attribute_group const _name##_group = {			\
+	.attrs = _name##_attrs,						\
+};									\
+static struct attribute_group const *_name##_groups[] = {		\
+	&_name##_group,							\
+	NULL,								\
+}
+
+int sysfs_create_group(struct kobject *kobj, struct attribute_group const *grp);
+void sysfs_remove_group(struct kobject *kobj, struct attribute_group const *grp);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef _LINUX_STUB_TRACEPOINT_H_
+#define _LINUX_STUB_TRACEPOINT_H_
+
+/* Tracepoints are compiled out, events only keep their prototype */
+#define TP_PROTO(...) __VA_ARGS__
+#define TP_ARGS(...) __VA_ARGS__
+
+#define TRACE_DEFINE_ENUM(a)
+
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print)		\
+static inline void trace_##name(proto)					\
+{									\
+}
+
+#endif
@@ -3,10 +3,23 @@
 
 #include <stdint.h>
 
+#define bool uint8_t
 #define u8 uint8_t
 #define u16 uint16_t
 #define u32 uint32_t
 #define u64 uint64_t
+#define s8 int8_t
+#define s16 int16_t
+#define s32 int32_t
+#define s64 int64_t
+#define __u8 uint8_t
+#define __u16 uint16_t
+#define __u32 uint32_t
+#define __u64 uint64_t
+#define __s32 int32_t
+#define __le32 uint32_t
+#define __le64 uint64_t
+#define umode_t unsigned short
 
 struct list_head {
 	struct list_head *next, *prev;
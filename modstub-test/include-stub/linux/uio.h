@@ -0,0 +1,36 @@
+#ifndef _LINUX_STUB_UIO_H_
+#define _LINUX_STUB_UIO_H_
+
+#include <string.h>
+#include <linux/types.h>
+
+/* Single user buffer iterator */
+struct iov_iter {
+	char const *buf;
+	size_t count;
+};
+
+static inline void iov_iter_init(struct iov_iter *i, char const *buf,
+		size_t count)
+{
+	i->buf = buf;
+	i->count = count;
+}
+
+static inline size_t iov_iter_count(struct iov_iter const *i)
+{
+	return i->count;
+}
+
+static inline size_t copy_from_iter(void *addr, size_t bytes,
+		struct iov_iter *i)
+{
+	if(bytes > i->count)
+		bytes = i->count;
+	memcpy(addr, i->buf, bytes);
+	i->buf += bytes;
+	i->count -= bytes;
+	return bytes;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _LINUX_STUB_VMALLOC_H_
+#define _LINUX_STUB_VMALLOC_H_
+
+#include <stdlib.h>
+#include <linux/mm.h>
+
+#define vmalloc(s) malloc(s)
+#define vzalloc(s) calloc(1, s)
+#define vmalloc_user(s) calloc(1, s)
+#define vfree(p) free((void *)p)
+
+/* Mapping is the buffer itself here, vm_start being set to it */
+static inline int remap_vmalloc_range(struct vm_area_struct *vma, void *addr,
+		unsigned long pgoff)
+{
+	vma->vm_start = (unsigned long)addr + pgoff * PAGE_SIZE;
+	return 0;
+}
+
+#endif
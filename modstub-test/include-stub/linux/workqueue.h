@@ -0,0 +1,77 @@
+#ifndef _LINUX_STUB_WORKQUEUE_H_
+#define _LINUX_STUB_WORKQUEUE_H_
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/jiffies.h>
+
+/*
+ * Each workqueue runs its work items in order from its own thread, delayed
+ * ones being queued once their delay expires (see workqueue.c).
+ */
+struct work_struct;
+struct workqueue_struct;
+typedef void (*work_func_t)(struct work_struct *work);
+
+struct work_struct {
+	work_func_t func;
+	struct list_head entry;
+	struct workqueue_struct *wq;
+	bool pending;
+};
+
+struct delayed_work {
+	struct work_struct work;
+	u64 expires;
+	bool timer;
+};
+
+#define INIT_WORK(_work, _func) do {					\
+		(_work)->func = (_func);				\
+		INIT_LIST_HEAD(&(_work)->entry);			\
+		(_work)->wq = NULL;					\
+		(_work)->pending = false;				\
+} while(0)
+
+#define INIT_DELAYED_WORK(_dwork, _func) do {				\
+		INIT_WORK(&(_dwork)->work, (_func));			\
+		(_dwork)->expires = 0;					\
+		(_dwork)->timer = false;				\
+} while(0)
+
+#define to_delayed_work(_work) container_of(_work, struct delayed_work, work)
+
+extern struct workqueue_struct *system_wq;
+extern struct workqueue_struct *system_long_wq;
+
+bool work_pending(struct work_struct *work);
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work);
+bool queue_delayed_work(struct workqueue_struct *wq,
+		struct delayed_work *dwork, unsigned long delay);
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork,
+		unsigned long delay);
+bool cancel_work_sync(struct work_struct *work);
+bool cancel_delayed_work(struct delayed_work *dwork);
+bool cancel_delayed_work_sync(struct delayed_work *dwork);
+bool flush_work(struct work_struct *work);
+bool flush_delayed_work(struct delayed_work *dwork);
+void flush_workqueue(struct workqueue_struct *wq);
+
+static inline bool delayed_work_pending(struct delayed_work *dwork)
+{
+	return work_pending(&dwork->work);
+}
+
+static inline bool schedule_work(struct work_struct *work)
+{
+	return queue_work(system_wq, work);
+}
+
+static inline bool schedule_delayed_work(struct delayed_work *dwork,
+		unsigned long delay)
+{
+	return queue_delayed_work(system_wq, dwork, delay);
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _STUB_SPILOG_H_
+#define _STUB_SPILOG_H_
+
+#include <stddef.h>
+
+#include <linux/types.h>
+
+/*
+ * Binary log of stub spi transfers and gpio accesses, kept in memory once
+ * started and dumped to a file, decoded by spilog-decode. The file is a
+ * struct spilog_hdr followed by records, each one 8 bytes aligned and, for
+ * a spi one, followed by its len transferred bytes.
+ */
+#define SPILOG_MAGIC 0x4c495053 /* "SPIL" */
+#define SPILOG_VERSION 1
+
+#define SPILOG_SPI 0
+#define SPILOG_GPIO_SET 1
+#define SPILOG_GPIO_GET 2
+
+/* Chip select released after this transfer */
+#define SPILOG_CS_CHANGE 0x1
+
+struct spilog_hdr {
+	__u32 magic;
+	__u32 version;
+	__u64 nr;
+	__u64 dropped;
+};
+
+/**
+ * struct spilog_rec - one logged access
+ * @time_ns: virtual CLOCK_MONOTONIC time
+ * @type: SPILOG_* access type
+ * @flags: SPILOG_CS_CHANGE for a spi transfer
+ * @gpio: accessed gpio
+ * @len: transfer length, or gpio value
+ */
+struct spilog_rec {
+	__u64 time_ns;
+	__u8 type;
+	__u8 flags;
+	__u16 gpio;
+	__u32 len;
+};
+
+#define SPILOG_REC_SZ(len) ((sizeof(struct spilog_rec) + (len) + 7) & ~7UL)
+
+/* Print every spi byte and gpio access, as text, instead */
+extern bool stub_verbose;
+
+int spilog_start(size_t size);
+void spilog_add(unsigned int type, unsigned int flags, unsigned int gpio,
+		void const *data, size_t len);
+int spilog_dump(char const *path);
+void spilog_hash_start(void);
+u64 spilog_hash(u64 *nr);
+
+#endif
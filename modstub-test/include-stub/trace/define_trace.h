@@ -0,0 +1 @@
+/* Trace headers are only read once, no tracepoint is created */
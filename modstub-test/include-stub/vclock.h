@@ -0,0 +1,39 @@
+#ifndef _STUB_VCLOCK_H_
+#define _STUB_VCLOCK_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include <linux/types.h>
+
+/*
+ * Virtual CLOCK_MONOTONIC, in ns. It never moves on its own: delays and sleeps
+ * advance it right away, and stub hardware advances it by the modelled cost of
+ * each access, so that a run is fast and its timings exact. Tasks waiting for
+ * it, or for anything else (workqueues, timers, completions), sleep on
+ * vclock_cond under vclock_lock.
+ */
+#define VCLOCK_BOOT_NS 1000000000ULL
+#define VCLOCK_REAL_OFFSET_NS 1451606400000000000LL
+
+/* Modelled costs */
+#define VCLOCK_SPI_HZ 12000000
+#define VCLOCK_SPI_XFER_NS 1000
+#define VCLOCK_GPIO_NS 100
+#define VCLOCK_RELAX_NS 1000
+
+extern pthread_mutex_t vclock_lock;
+extern pthread_cond_t vclock_cond;
+
+u64 vclock_now(void);
+void vclock_advance(u64 ns);
+void vclock_sleep_until(u64 ns);
+void vclock_wait(u64 ns);
+
+static inline u64 vclock_spi_ns(size_t len)
+{
+	return VCLOCK_SPI_XFER_NS + (u64)len * 8 * 1000000000ULL /
+		VCLOCK_SPI_HZ;
+}
+
+#endif
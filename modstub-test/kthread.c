@@ -0,0 +1,57 @@
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/kthread.h>
+
+static __thread struct task_struct *current_task;
+
+static void *kthread(void *arg)
+{
+	struct task_struct *k = arg;
+
+	current_task = k;
+	k->ret = k->threadfn(k->data);
+	return NULL;
+}
+
+struct task_struct *kthread_create(int (*threadfn)(void *data), void *data,
+		char const *namefmt, ...)
+{
+	struct task_struct *k;
+	va_list args;
+
+	k = kzalloc(sizeof(*k), GFP_KERNEL);
+	if(k == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	k->threadfn = threadfn;
+	k->data = data;
+	va_start(args, namefmt);
+	vsnprintf(k->comm, sizeof(k->comm), namefmt, args);
+	va_end(args);
+
+	if(pthread_create(&k->thread, NULL, kthread, k) != 0) {
+		kfree(k);
+		return ERR_PTR(-EAGAIN);
+	}
+
+	return k;
+}
+
+bool kthread_should_stop(void)
+{
+	return current_task != NULL && READ_ONCE(current_task->should_stop);
+}
+
+int kthread_stop(struct task_struct *k)
+{
+	int ret;
+
+	WRITE_ONCE(k->should_stop, true);
+	pthread_join(k->thread, NULL);
+	ret = k->ret;
+	kfree(k);
+	return ret;
+}
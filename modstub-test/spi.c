@@ -3,6 +3,9 @@
 #include <linux/list.h>
 #include <linux/of_device.h>
 
+#include <vclock.h>
+#include <spilog.h>
+
 int spi_setup(struct spi_device *spi)
 {
 	(void)spi;
@@ -16,15 +19,26 @@ int spi_sync_transfer(struct spi_device *spi, struct spi_transfer *xfers,
 
 	(void)spi;
 
-	printk("SPI TRANSFER BEGIN \n");
-	for(i = 0; i < num_xfers; ++i) {
-		for(j = 0; j < xfers[i].len; ++j)
-			printk("0x%02x ", ((u8 *)xfers[i].tx_buf)[j]);
+	if(stub_verbose) {
+		printk("SPI TRANSFER BEGIN \n");
+		for(i = 0; i < num_xfers; ++i) {
+			for(j = 0; j < xfers[i].len; ++j)
+				printk("0x%02x ", ((u8 *)xfers[i].tx_buf)[j]);
+
+			if(xfers[i].cs_change)
+				printk(" -- ");
+		}
+		printk("\nSPI TRANSFER END \n");
+	}
 
-		if(xfers[i].cs_change)
-			printk(" -- ");
+	/* Log transfers and account their bus time, as if at VCLOCK_SPI_HZ */
+	for(i = 0; i < num_xfers; ++i) {
+		spilog_add(SPILOG_SPI,
+				xfers[i].cs_change ? SPILOG_CS_CHANGE : 0, 0,
+				xfers[i].tx_buf, xfers[i].len);
+		vclock_advance(vclock_spi_ns(xfers[i].len) +
+				xfers[i].delay_usecs * 1000ULL);
 	}
-	printk("\nSPI TRANSFER END \n");
 
 	return 0;
 }
@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <spilog.h>
+
+/*
+ * Pretty print a stub spi log, as dumped by "epd_test -o <log>", one access
+ * per line with its virtual time. Gpio reads (e.g. busy line polls) are only
+ * printed with -g.
+ */
+
+static void print_spi(struct spilog_rec const *rec, u8 const *data)
+{
+	__u32 i;
+
+	printf("spi");
+	for(i = 0; i < rec->len; ++i)
+		printf(" %02x", data[i]);
+	printf("%s\n", (rec->flags & SPILOG_CS_CHANGE) ? " cs" : "");
+}
+
+int main(int argc, char *argv[])
+{
+	struct spilog_hdr hdr;
+	struct spilog_rec rec;
+	u8 *data = NULL;
+	size_t sz, max = 0;
+	int gets = 0, ret = EXIT_FAILURE;
+	char const *path;
+	FILE *fp;
+
+	if(argc == 3 && strcmp(argv[1], "-g") == 0)
+		gets = 1;
+	if(argc != 2 + gets) {
+		fprintf(stderr, "Usage: %s [-g] <log>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	path = argv[1 + gets];
+
+	fp = fopen(path, "rb");
+	if(fp == NULL) {
+		perror(path);
+		return EXIT_FAILURE;
+	}
+
+	if(fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != SPILOG_MAGIC ||
+			hdr.version != SPILOG_VERSION) {
+		fprintf(stderr, "%s: not a spi log\n", path);
+		goto out;
+	}
+
+	while(fread(&rec, sizeof(rec), 1, fp) == 1) {
+		sz = SPILOG_REC_SZ((rec.type == SPILOG_SPI) ? rec.len : 0) -
+			sizeof(rec);
+		if(sz > max) {
+			free(data);
+			data = malloc(sz);
+			if(data == NULL) {
+				fprintf(stderr, "Cannot allocate record\n");
+				goto out;
+			}
+			max = sz;
+		}
+		if(sz != 0 && fread(data, 1, sz, fp) != sz) {
+			fprintf(stderr, "%s: truncated record\n", path);
+			goto out;
+		}
+
+		if(rec.type == SPILOG_GPIO_GET && !gets)
+			continue;
+
+		printf("[%5llu.%09llu] ",
+				(unsigned long long)rec.time_ns / 1000000000,
+				(unsigned long long)rec.time_ns % 1000000000);
+		switch(rec.type) {
+		case SPILOG_SPI:
+			print_spi(&rec, data);
+			break;
+		case SPILOG_GPIO_SET:
+			printf("gpio %u set %u\n", rec.gpio, rec.len);
+			break;
+		case SPILOG_GPIO_GET:
+			printf("gpio %u get %u\n", rec.gpio, rec.len);
+			break;
+		default:
+			printf("unknown record %u\n", rec.type);
+			break;
+		}
+	}
+
+	if(hdr.dropped != 0)
+		printf("%llu of %llu accesses dropped, log was full\n",
+				(unsigned long long)hdr.dropped,
+				(unsigned long long)(hdr.nr + hdr.dropped));
+	ret = EXIT_SUCCESS;
+out:
+	free(data);
+	fclose(fp);
+	return ret;
+}
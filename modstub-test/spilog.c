@@ -0,0 +1,161 @@
+#include <pthread.h>
+
+#include <linux/module.h>
+#include <linux/slab.h>
+
+#include <vclock.h>
+#include <spilog.h>
+
+bool stub_verbose;
+
+static pthread_mutex_t spilog_lock = PTHREAD_MUTEX_INITIALIZER;
+static u8 *spilog;
+static size_t spilog_size;
+static size_t spilog_len;
+static u64 spilog_nr;
+static u64 spilog_dropped;
+static bool spilog_hashing;
+static u64 spilog_hash_val;
+static u64 spilog_hash_nr;
+static u64 spilog_hash_t0;
+
+/* Log accesses into a size bytes buffer, later ones being dropped once full */
+int spilog_start(size_t size)
+{
+	u8 *buf;
+
+	buf = kmalloc(size, GFP_KERNEL);
+	if(buf == NULL)
+		return -ENOMEM;
+
+	pthread_mutex_lock(&spilog_lock);
+	kfree(spilog);
+	spilog = buf;
+	spilog_size = size;
+	spilog_len = 0;
+	spilog_nr = 0;
+	spilog_dropped = 0;
+	pthread_mutex_unlock(&spilog_lock);
+	return 0;
+}
+
+static u64 spilog_fnv(u64 hash, void const *data, size_t len)
+{
+	u8 const *p = data;
+	size_t i;
+
+	for(i = 0; i < len; ++i) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/*
+ * Hash an access as spilog-decode prints it, gpio reads aside, its time being
+ * relative to the first hashed one.
+ */
+static void spilog_hash_add(struct spilog_rec *rec, void const *data)
+{
+	if(rec->type == SPILOG_GPIO_GET)
+		return;
+
+	if(spilog_hash_nr++ == 0)
+		spilog_hash_t0 = rec->time_ns;
+	rec->time_ns -= spilog_hash_t0;
+	spilog_hash_val = spilog_fnv(spilog_hash_val, rec, sizeof(*rec));
+	if(rec->type == SPILOG_SPI)
+		spilog_hash_val = spilog_fnv(spilog_hash_val, data, rec->len);
+}
+
+/* Log a spi transfer of len bytes from data, or a gpio access of value len */
+void spilog_add(unsigned int type, unsigned int flags, unsigned int gpio,
+		void const *data, size_t len)
+{
+	struct spilog_rec *rec, hrec = {
+		.time_ns = vclock_now(),
+		.type = type,
+		.flags = flags,
+		.gpio = gpio,
+		.len = len,
+	};
+	size_t sz = SPILOG_REC_SZ((type == SPILOG_SPI) ? len : 0);
+
+	pthread_mutex_lock(&spilog_lock);
+	if(spilog_hashing)
+		spilog_hash_add(&hrec, data);
+	if(spilog == NULL)
+		goto out;
+
+	if(sz > spilog_size - spilog_len) {
+		++spilog_dropped;
+		goto out;
+	}
+
+	rec = (struct spilog_rec *)(spilog + spilog_len);
+	memset(rec, 0, sz);
+	rec->time_ns = vclock_now();
+	rec->type = type;
+	rec->flags = flags;
+	rec->gpio = gpio;
+	rec->len = len;
+	if(type == SPILOG_SPI)
+		memcpy(rec + 1, data, len);
+	spilog_len += sz;
+	++spilog_nr;
+out:
+	pthread_mutex_unlock(&spilog_lock);
+}
+
+int spilog_dump(char const *path)
+{
+	struct spilog_hdr hdr = {
+		.magic = SPILOG_MAGIC,
+		.version = SPILOG_VERSION,
+	};
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(path, "wb");
+	if(fp == NULL)
+		return -errno;
+
+	pthread_mutex_lock(&spilog_lock);
+	hdr.nr = spilog_nr;
+	hdr.dropped = spilog_dropped;
+	if(fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+			fwrite(spilog, 1, spilog_len, fp) != spilog_len)
+		ret = -EIO;
+	pthread_mutex_unlock(&spilog_lock);
+
+	if(fclose(fp) != 0 && ret == 0)
+		ret = -EIO;
+	return ret;
+}
+
+/* Start hashing accesses, logged or not, for spilog_hash() */
+void spilog_hash_start(void)
+{
+	pthread_mutex_lock(&spilog_lock);
+	spilog_hashing = true;
+	spilog_hash_val = 0xcbf29ce484222325ULL;
+	spilog_hash_nr = 0;
+	pthread_mutex_unlock(&spilog_lock);
+}
+
+/*
+ * FNV-1a hash of accesses since spilog_hash_start(), that is of what
+ * spilog-decode prints of them (gpio reads aside), times being relative to the
+ * first one, and stop hashing. Set nr to the number of accesses hashed.
+ */
+u64 spilog_hash(u64 *nr)
+{
+	u64 hash;
+
+	pthread_mutex_lock(&spilog_lock);
+	hash = spilog_hash_val;
+	*nr = spilog_hash_nr;
+	spilog_hashing = false;
+	pthread_mutex_unlock(&spilog_lock);
+	return hash;
+}
@@ -0,0 +1,69 @@
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/sysfs.h>
+
+int sysfs_create_group(struct kobject *kobj, struct attribute_group const *grp)
+{
+	size_t i;
+
+	for(i = 0; i < SYSFS_GROUPS_MAX; ++i) {
+		if(kobj->groups[i] == NULL) {
+			kobj->groups[i] = grp;
+			return 0;
+		}
+	}
+
+	return -ENOMEM;
+}
+
+void sysfs_remove_group(struct kobject *kobj, struct attribute_group const *grp)
+{
+	size_t i;
+
+	for(i = 0; i < SYSFS_GROUPS_MAX; ++i) {
+		if(kobj->groups[i] == grp)
+			kobj->groups[i] = NULL;
+	}
+}
+
+static struct device_attribute *device_attr_find(struct device *dev,
+		char const *name)
+{
+	struct attribute **attr;
+	size_t i;
+
+	for(i = 0; i < SYSFS_GROUPS_MAX; ++i) {
+		if(dev->kobj.groups[i] == NULL)
+			continue;
+		for(attr = dev->kobj.groups[i]->attrs; *attr != NULL; ++attr) {
+			if(strcmp((*attr)->name, name) == 0)
+				return container_of(*attr,
+						struct device_attribute, attr);
+		}
+	}
+
+	return NULL;
+}
+
+ssize_t device_attr_show(struct device *dev, char const *name, char *buf)
+{
+	struct device_attribute *attr;
+
+	attr = device_attr_find(dev, name);
+	if(attr == NULL || attr->show == NULL)
+		return -ENOENT;
+
+	return attr->show(dev, attr, buf);
+}
+
+ssize_t device_attr_store(struct device *dev, char const *name,
+		char const *buf)
+{
+	struct device_attribute *attr;
+
+	attr = device_attr_find(dev, name);
+	if(attr == NULL || attr->store == NULL)
+		return -ENOENT;
+
+	return attr->store(dev, attr, buf, strlen(buf));
+}
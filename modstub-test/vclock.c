@@ -0,0 +1,54 @@
+#include <linux/module.h>
+
+#include <vclock.h>
+
+pthread_mutex_t vclock_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t vclock_cond = PTHREAD_COND_INITIALIZER;
+
+static u64 vclock = VCLOCK_BOOT_NS;
+/* Earliest time a task waits for, vclock_lock being held */
+static u64 vclock_next = ~0ULL;
+
+u64 vclock_now(void)
+{
+	return __atomic_load_n(&vclock, __ATOMIC_ACQUIRE);
+}
+
+static void __vclock_set(u64 now)
+{
+	__atomic_store_n(&vclock, now, __ATOMIC_RELEASE);
+	if(now >= vclock_next) {
+		vclock_next = ~0ULL;
+		pthread_cond_broadcast(&vclock_cond);
+	}
+}
+
+void vclock_advance(u64 ns)
+{
+	pthread_mutex_lock(&vclock_lock);
+	__vclock_set(vclock + ns);
+	pthread_mutex_unlock(&vclock_lock);
+}
+
+/* Sleeping task is the one moving time forward */
+void vclock_sleep_until(u64 ns)
+{
+	pthread_mutex_lock(&vclock_lock);
+	if(ns > vclock)
+		__vclock_set(ns);
+	pthread_mutex_unlock(&vclock_lock);
+}
+
+/*
+ * Wait, vclock_lock being held, until clock reaches ns or vclock_cond is
+ * broadcast for another reason. Callers recheck their condition on return.
+ */
+void vclock_wait(u64 ns)
+{
+	if(vclock >= ns)
+		return;
+
+	if(ns < vclock_next)
+		vclock_next = ns;
+	pthread_cond_wait(&vclock_cond, &vclock_lock);
+}
@@ -0,0 +1,244 @@
+#include <pthread.h>
+
+#include <linux/module.h>
+#include <linux/workqueue.h>
+
+#include <vclock.h>
+
+/*
+ * A workqueue thread is started with its first queued work. Workqueues are
+ * protected by vclock_lock and vclock_cond is broadcast on any work queued or
+ * done, delayed works expiring on virtual jiffies. A delayed work timer flag is
+ * only meaningful while it is pending.
+ */
+struct workqueue_struct {
+	char const *name;
+	struct list_head works;
+	struct list_head delayed;
+	struct work_struct *running;
+	bool started;
+};
+
+#define WORKQUEUE_INIT(_wq, _name) {					\
+	.name = _name,							\
+	.works = LIST_HEAD_INIT(_wq.works),				\
+	.delayed = LIST_HEAD_INIT(_wq.delayed),				\
+}
+
+static struct workqueue_struct wq_system = WORKQUEUE_INIT(wq_system, "events");
+static struct workqueue_struct wq_long = WORKQUEUE_INIT(wq_long, "events_long");
+
+struct workqueue_struct *system_wq = &wq_system;
+struct workqueue_struct *system_long_wq = &wq_long;
+
+/* Move expired delayed works to ready list, return next expiry or 0 */
+static u64 wq_expire(struct workqueue_struct *wq)
+{
+	struct delayed_work *dwork, *tmp;
+	u64 now = jiffies, next = 0;
+
+	list_for_each_entry_safe(dwork, tmp, &wq->delayed, work.entry) {
+		if(dwork->expires <= now) {
+			list_move_tail(&dwork->work.entry, &wq->works);
+			dwork->timer = false;
+		} else if(next == 0 || dwork->expires < next) {
+			next = dwork->expires;
+		}
+	}
+
+	return next;
+}
+
+static void *wq_thread(void *arg)
+{
+	struct workqueue_struct *wq = arg;
+	struct work_struct *work;
+	u64 next;
+
+	pthread_mutex_lock(&vclock_lock);
+	for(;;) {
+		next = wq_expire(wq);
+		if(list_empty(&wq->works)) {
+			if(next == 0)
+				pthread_cond_wait(&vclock_cond, &vclock_lock);
+			else
+				vclock_wait(next * 1000);
+			continue;
+		}
+
+		work = list_first_entry(&wq->works, struct work_struct, entry);
+		list_del_init(&work->entry);
+		work->pending = false;
+		wq->running = work;
+		pthread_mutex_unlock(&vclock_lock);
+
+		work->func(work);
+
+		pthread_mutex_lock(&vclock_lock);
+		wq->running = NULL;
+		pthread_cond_broadcast(&vclock_cond);
+	}
+
+	return NULL;
+}
+
+/* Queue a not pending work, vclock_lock being held */
+static void wq_add(struct workqueue_struct *wq, struct work_struct *work,
+		struct list_head *list)
+{
+	pthread_t thread;
+
+	if(!wq->started) {
+		if(pthread_create(&thread, NULL, wq_thread, wq) != 0) {
+			printk("Cannot start %s workqueue\n", wq->name);
+			return;
+		}
+		pthread_detach(thread);
+		wq->started = true;
+	}
+
+	work->pending = true;
+	work->wq = wq;
+	list_add_tail(&work->entry, list);
+	pthread_cond_broadcast(&vclock_cond);
+}
+
+/* Remove a pending work from its queue, vclock_lock being held */
+static bool wq_del(struct work_struct *work)
+{
+	if(!work->pending)
+		return false;
+
+	list_del_init(&work->entry);
+	work->pending = false;
+	return true;
+}
+
+static void wq_add_delayed(struct workqueue_struct *wq,
+		struct delayed_work *dwork, unsigned long delay)
+{
+	if(delay == 0) {
+		dwork->timer = false;
+		wq_add(wq, &dwork->work, &wq->works);
+		return;
+	}
+
+	dwork->expires = jiffies + delay;
+	dwork->timer = true;
+	wq_add(wq, &dwork->work, &wq->delayed);
+}
+
+bool work_pending(struct work_struct *work)
+{
+	bool ret;
+
+	pthread_mutex_lock(&vclock_lock);
+	ret = work->pending;
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool queue_work(struct workqueue_struct *wq, struct work_struct *work)
+{
+	bool ret = false;
+
+	pthread_mutex_lock(&vclock_lock);
+	if(!work->pending) {
+		wq_add(wq, work, &wq->works);
+		ret = true;
+	}
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool queue_delayed_work(struct workqueue_struct *wq,
+		struct delayed_work *dwork, unsigned long delay)
+{
+	bool ret = false;
+
+	pthread_mutex_lock(&vclock_lock);
+	if(!dwork->work.pending) {
+		wq_add_delayed(wq, dwork, delay);
+		ret = true;
+	}
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool mod_delayed_work(struct workqueue_struct *wq, struct delayed_work *dwork,
+		unsigned long delay)
+{
+	bool ret;
+
+	pthread_mutex_lock(&vclock_lock);
+	ret = wq_del(&dwork->work);
+	wq_add_delayed(wq, dwork, delay);
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool cancel_delayed_work(struct delayed_work *dwork)
+{
+	bool ret;
+
+	pthread_mutex_lock(&vclock_lock);
+	ret = wq_del(&dwork->work);
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool cancel_work_sync(struct work_struct *work)
+{
+	bool ret;
+
+	pthread_mutex_lock(&vclock_lock);
+	ret = wq_del(work);
+	while(work->wq != NULL && work->wq->running == work)
+		pthread_cond_wait(&vclock_cond, &vclock_lock);
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+	return cancel_work_sync(&dwork->work);
+}
+
+bool flush_work(struct work_struct *work)
+{
+	bool ret;
+
+	pthread_mutex_lock(&vclock_lock);
+	ret = work->pending ||
+		(work->wq != NULL && work->wq->running == work);
+	while(work->pending ||
+			(work->wq != NULL && work->wq->running == work))
+		pthread_cond_wait(&vclock_cond, &vclock_lock);
+	pthread_mutex_unlock(&vclock_lock);
+	return ret;
+}
+
+bool flush_delayed_work(struct delayed_work *dwork)
+{
+	struct workqueue_struct *wq;
+
+	/* Run a waiting delayed work now */
+	pthread_mutex_lock(&vclock_lock);
+	wq = dwork->work.wq;
+	if(dwork->timer && wq_del(&dwork->work)) {
+		dwork->timer = false;
+		wq_add(wq, &dwork->work, &wq->works);
+	}
+	pthread_mutex_unlock(&vclock_lock);
+
+	return flush_work(&dwork->work);
+}
+
+/* Wait for queued works, not for delayed ones still waiting */
+void flush_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&vclock_lock);
+	while(!list_empty(&wq->works) || wq->running != NULL)
+		pthread_cond_wait(&vclock_cond, &vclock_lock);
+	pthread_mutex_unlock(&vclock_lock);
+}
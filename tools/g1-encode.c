@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "epd_g1_enc.h"
+
+/*
+ * Pre-encode a G1 panel update from an old frame to a new one, to be drawn
+ * with EPD_IOC_DRAW_ENCODED. Frames are raw untransformed framebuffer dumps
+ * (as read from or written to /dev/epd<id>).
+ */
+
+static struct epd_frame *frame_load(char const *path, size_t nrline,
+		size_t nrdot)
+{
+	struct epd_frame *f;
+	size_t sz = nrline * DIV_ROUND_UP(nrdot, 8);
+	FILE *fp;
+
+	f = calloc(1, sizeof(*f) + sz);
+	if(f == NULL) {
+		fprintf(stderr, "Cannot allocate frame\n");
+		return NULL;
+	}
+
+	f->nrline = nrline;
+	f->nrdot = nrdot;
+	f->bytes_per_line = DIV_ROUND_UP(nrdot, 8);
+
+	fp = fopen(path, "rb");
+	if(fp == NULL) {
+		perror(path);
+		goto err;
+	}
+
+	if(fread(f->data, 1, sz, fp) != sz) {
+		fprintf(stderr, "%s: frame should be %zu bytes\n", path, sz);
+		fclose(fp);
+		goto err;
+	}
+
+	fclose(fp);
+	return f;
+err:
+	free(f);
+	return NULL;
+}
+
+static int parse_type(char const *str, enum g1_screen_type *type)
+{
+	if(strcmp(str, "1.44") == 0)
+		*type = G1_TYPE_1_44;
+	else if(strcmp(str, "2") == 0)
+		*type = G1_TYPE_2;
+	else if(strcmp(str, "2.7") == 0)
+		*type = G1_TYPE_2_7;
+	else
+		return -EINVAL;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct epd_frame_size const *fsz;
+	struct epd_frame *fold = NULL, *fnew = NULL;
+	enum g1_screen_type type;
+	size_t img_sz;
+	u8 *img = NULL;
+	FILE *fp;
+	int ret = EXIT_FAILURE;
+
+	if(argc != 5 || parse_type(argv[1], &type) < 0) {
+		fprintf(stderr, "Usage: %s <1.44|2|2.7> <old frame> "
+				"<new frame> <output>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	g1_init_native_lut();
+
+	fsz = &g1_frame_info[type];
+	img_sz = g1_img_sz(type);
+
+	fold = frame_load(argv[2], fsz->line, fsz->col);
+	fnew = frame_load(argv[3], fsz->line, fsz->col);
+	img = calloc(1, img_sz);
+	if(fold == NULL || fnew == NULL || img == NULL)
+		goto out;
+
+	if(g1_img_build(type, fold, fnew, img) < 0) {
+		fprintf(stderr, "Cannot encode update\n");
+		goto out;
+	}
+
+	fp = fopen(argv[4], "wb");
+	if(fp == NULL) {
+		perror(argv[4]);
+		goto out;
+	}
+
+	if(fwrite(img, 1, img_sz, fp) != img_sz)
+		perror(argv[4]);
+	else
+		ret = EXIT_SUCCESS;
+
+	fclose(fp);
+out:
+	free(img);
+	free(fnew);
+	free(fold);
+	return ret;
+}